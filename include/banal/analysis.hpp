@@ -8,12 +8,19 @@
 
 #pragma once
 
+#include <memory>
 #include <optional>
+#include <vector>
 
 #include "banal/binary/binary.hpp"
+#include "banal/execution/engine.hpp"
+#include "banal/execution/handles.hpp"
+#include "banal/execution/input.hpp"
+#include "banal/execution/snapshot.hpp"
 #include "banal/execution/stack.hpp"
-#include "banal/extern/capstone.hpp"
-#include "banal/extern/unicorn.hpp"
+#include "banal/execution/tracer.hpp"
+#include "banal/trace/writer.hpp"
+#include "banal/finding.hpp"
 #include "banal/options.hpp"
 
 namespace banal {
@@ -24,11 +31,8 @@ private:
   /// \brief Options supplied by the user
   [[maybe_unused]] const Options& _options;
 
-  /// \brief Capstone handler
-  ::csh _csh;
-
-  /// \brief Unicorn handler
-  ::uc_engine* _uc;
+  /// \brief Capstone and Unicorn handlers
+  execution::Handles _handles;
 
   /// \brief Mapped binary, if any
   /// Optional reference IS ILLEGAL
@@ -37,6 +41,24 @@ private:
   /// \brief Virtal address of the binary
   ::std::optional<::std::uint64_t > _virtual_binary_address;
 
+  /// \brief Tracer, in instruction mode
+  ::std::unique_ptr< execution::Tracer > _tracer;
+
+  /// \brief Compact trace writer, if asked
+  ::std::unique_ptr< trace::Writer > _writer;
+
+  /// \brief Execution engine, built by the first run
+  ::std::unique_ptr< execution::Engine > _engine;
+
+  /// \brief Emulation state at main, taken by the first run
+  ::std::unique_ptr< execution::Snapshot > _main;
+
+  /// \brief Input given on the command line
+  execution::Input _seed;
+
+  /// \brief Inputs which made the program fault, one per faulting address
+  ::std::vector< Finding > _findings;
+
   /// \brief Tell if it is good
   bool _good;
 
@@ -54,11 +76,24 @@ public:
   Analysis operator=(const Analysis&) = delete;
 
   /// \brief Move constructor
-  Analysis(Analysis&&) = default;
+  Analysis(Analysis&&) = delete;
 
   /// \brief Destructor
   ~Analysis(void);
 
+private:
+  /// \brief Build the execution engine and take the snapshot at main, or
+  /// restore it
+  ///
+  /// \return true if the emulation state is at main, else false
+  bool reset(void);
+
+  /// \brief Print a finding
+  ///
+  /// \param index Index of the finding
+  /// \param finding The finding
+  void report(::std::size_t index, const Finding& finding) const;
+
 public:
   /// \brief Get the mapped binary, if any
   ///
@@ -78,19 +113,31 @@ public:
 
   /// \brief Start the analysis, beginning at an entry point
   ///
+  /// The first run builds the execution engine, and takes a snapshot at
+  /// main. Next runs restore this snapshot instead.
+  ///
   /// \param entry the analysis, at entry given by entry
   void start(::std::uint64_t entry);
 
-public:
-  /// \brief Intercept call/jmp
-  static void hook_basic_block(::uc_engine* uc,
-                               ::std::uint64_t address,
-                               ::std::uint32_t size,
-                               void* user_data);
+  /// \brief Explore: run mutated inputs, restoring the snapshot at main
+  /// before each run
+  ///
+  /// Runs are spread over a pool of workers, each one owns its handlers and
+  /// its engine. Each run spawns mutations of its input, a work-stealing
+  /// scheduler balances them between workers.
+  ///
+  /// \param iterations Number of runs
+  void explore(::std::size_t iterations);
 
-private:
-  /// \ßrief Intercept call/jmp
-  void hook_basic_block(uintarch_t address, ::std::uint32_t size);
+  /// \brief Get the findings
+  ///
+  /// \return The findings
+  inline const auto& findings(void) const { return _findings; }
+
+  /// \brief Tell if it is good
+  ///
+  /// \return true if it is good, else false
+  inline auto good(void) const { return _good; }
 };
 
 } // end namespace banal
@@ -0,0 +1,220 @@
+///
+/// \file
+/// \brief Batch analysis specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+#include "banal/architecture.hpp"
+#include "banal/binary/binary.hpp"
+#include "banal/cache.hpp"
+#include "banal/execution/handles.hpp"
+#include "banal/execution/input.hpp"
+#include "banal/options.hpp"
+#include "banal/summary.hpp"
+#include "banal/util/queue.hpp"
+
+namespace banal {
+
+/// \brief Analyzes many binaries in one process, one run per binary
+///
+/// Binaries go through four stages, connected by bounded queues: mapping
+/// (with readahead), parsing, a static pre-pass and the emulation. Each
+/// stage has its own workers, so that disk reads overlap with the
+/// emulation, and the depth of the queues bounds the number of mapped
+/// binaries. Emulation workers keep one pair of handlers per architecture,
+/// reused from a binary to the next. Results are written as JSON lines, one
+/// per binary. With a cache, binaries analyzed by a previous batch are
+/// skipped right after parsing. Function summaries are shared by the
+/// workers, by normalized hash, and cached with one artifact per binary and
+/// one per function. Copies of a function are then summarized once, and the
+/// summaries of a binary found in the cache are shared as well, even when
+/// its result is.
+class Batch {
+private:
+  /// \brief A binary going through the stages
+  struct Item {
+    /// \brief Path of the binary
+    ::std::string path;
+
+    /// \brief The binary, once mapped
+    ::std::unique_ptr< binary::Binary > binary;
+
+    /// \brief Fields of the result record, after the path, without the time
+    /// so that they can be cached
+    ::std::string fields;
+
+    /// \brief Key in the cache, 0 if not computed
+    ::std::uint64_t key;
+
+    /// \brief When the binary has entered the pipeline
+    ::std::chrono::steady_clock::time_point begin;
+  };
+
+  /// \brief Queue between two stages
+  using Stage = util::Queue<::std::unique_ptr< Item > >;
+
+private:
+  /// \brief Options supplied by the user
+  const Options& _options;
+
+  /// \brief Paths of the binaries to analyze
+  util::Queue<::std::string > _paths;
+
+  /// \brief Mapped binaries, to parse
+  Stage _mapped;
+
+  /// \brief Parsed binaries, to check
+  Stage _parsed;
+
+  /// \brief Checked binaries, to emulate
+  Stage _ready;
+
+  /// \brief Input given on the command line, the path is prepended
+  execution::Input _seed;
+
+  /// \brief Results file, if not the standard output
+  ::std::ofstream _file;
+
+  /// \brief Results stream
+  ::std::ostream* _out;
+
+  /// \brief Protects the results stream and the counters
+  ::std::mutex _mutex;
+
+  /// \brief Number of binaries analyzed
+  ::std::size_t _done;
+
+  /// \brief Number of binaries which could not be analyzed
+  ::std::size_t _failed;
+
+  /// \brief Cache of the results, if any
+  ::std::unique_ptr< Cache > _cache;
+
+  /// \brief Hash of what results depend on, besides the binary
+  ::std::uint64_t _salt;
+
+  /// \brief Protects the summaries
+  ::std::mutex _summaries_mutex;
+
+  /// \brief Summaries of the functions seen so far, by normalized hash
+  ::std::unordered_map<::std::uint64_t, Summary > _summaries;
+
+  /// \brief Tell if it is good
+  bool _good;
+
+public:
+  /// \brief Constructor
+  ///
+  /// \param opt Options from the command line
+  Batch(const Options& opt);
+
+  /// \brief Copy constructor
+  Batch(const Batch&) = delete;
+
+  /// \brief Copy operator=
+  Batch operator=(const Batch&) = delete;
+
+  /// \brief Destructor
+  ~Batch(void) = default;
+
+public:
+  /// \brief Analyze every binary
+  ///
+  /// \return true if every binary has been analyzed, else false
+  bool run(void);
+
+  /// \brief Tell if it is good
+  ///
+  /// \return true if it is good, else false
+  inline auto good(void) const { return _good; }
+
+private:
+  /// \brief Push the paths to the queue, then close it
+  ///
+  /// \return false if the paths could not all be read, else true
+  bool produce(void);
+
+  /// \brief Open and map a binary, asking for readahead
+  ///
+  /// \param path Path of the binary
+  ///
+  /// \return The binary, or nullptr if it has been dropped
+  ::std::unique_ptr< Item > map(::std::string path);
+
+  /// \brief Parse a binary
+  ///
+  /// \param item The binary
+  ///
+  /// \return The binary, or nullptr if it has been dropped
+  ::std::unique_ptr< Item > parse(::std::unique_ptr< Item > item);
+
+  /// \brief Check a binary can be emulated, fault its loadable segments in
+  /// and summarize its functions
+  ///
+  /// \param item The binary
+  ///
+  /// \return The binary, or nullptr if it has been dropped
+  ::std::unique_ptr< Item > check(::std::unique_ptr< Item > item);
+
+  /// \brief Summarize the functions of a binary, reusing the summaries of
+  /// functions already seen
+  ///
+  /// \param item The binary
+  void summarize(Item& item);
+
+  /// \brief Share the cached summaries of a binary, which is not summarized
+  ///
+  /// \param binary The binary
+  void seed(const binary::Binary& binary);
+
+  /// \brief Emulate binaries until the queue is closed
+  void emulate(void);
+
+  /// \brief Emulate a binary
+  ///
+  /// \param item The binary
+  /// \param handles Handlers of the worker, by architecture
+  void emulate(Item& item,
+               ::std::map< Architecture, execution::Handles >& handles);
+
+  /// \brief Write the record of a binary which could not be analyzed
+  ///
+  /// \param item The binary
+  /// \param error Why
+  void fail(Item& item, ::std::string_view error);
+
+  /// \brief Write the record of a binary, and cache it
+  ///
+  /// \param item The binary
+  /// \param ok Tell if the binary has been analyzed
+  void finish(const Item& item, bool ok);
+
+  /// \brief Write a result record, with the time the binary has spent in
+  /// the pipeline
+  ///
+  /// \param item The binary
+  /// \param fields Fields of the record, after the path
+  /// \param ok Tell if the binary has been analyzed
+  /// \param cached Tell if the record comes from the cache
+  void write(const Item& item,
+             ::std::string_view fields,
+             bool ok,
+             bool cached);
+};
+
+} // end namespace banal
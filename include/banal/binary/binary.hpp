@@ -18,16 +18,18 @@
 #include "banal/architecture.hpp"
 #include "banal/binary/component/section.hpp"
 #include "banal/binary/component/segment.hpp"
+#include "banal/binary/component/symbol.hpp"
 #include "banal/format.hpp"
 #include "banal/options.hpp"
-#include "banal/util/mem_based_stream.hpp"
 
 namespace banal {
 namespace binary {
 
 /// \brief A binary to analyze
 class Binary {
-  friend ::std::unique_ptr< Binary > open(const ::banal::Options& opt);
+  friend ::std::unique_ptr< Binary > map(const ::banal::Options& opt,
+                                         const ::std::string& path);
+  friend bool parse(Binary& binary);
 
 private:
   /// \brief Address of the begin of the file
@@ -40,9 +42,6 @@ private:
   int _fd;
 
 protected:
-  /// \brief Mem based stream
-  util::MemBasedStream _stream;
-
   /// \brief Options
   const ::banal::Options& _opt;
 
@@ -66,7 +65,7 @@ public:
   /// \brief Move constructor
   Binary(Binary&&) = delete;
 
-  /// \brief Destructor
+  /// \brief Destructor, unmaps the file
   virtual ~Binary(void);
 
 public:
@@ -87,10 +86,10 @@ public:
   /// \return The end of the section to analyze
   inline auto* end(void) const { return _end; }
 
-  /// \brief Get the memory based stream
+  /// \brief Get the file descriptor of the binary
   ///
-  /// \return The memory based stream
-  inline auto& stream(void) { return _stream; }
+  /// \return The file descriptor
+  inline auto fd(void) const { return _fd; }
 
   /// \brief Tell if this is good or not
   ///
@@ -160,11 +159,18 @@ public:
       ::std::unique_ptr< component::Section > >::const_iterator
   sections_cend(void) const = 0;
 
-  /// \brief Get symbols map
+  /// \brief Find a defined symbol by name
+  ///
+  /// \param name Name of the symbol
   ///
-  /// \return Symbols map
-  virtual const ::std::unordered_map< uintarch_t, const component::Symbol& >&
-  symbols(void) const = 0;
+  /// \return The symbol if exists, else nothing
+  virtual ::std::optional< component::Symbol > find_symbol(
+      ::std::string_view name) const = 0;
+
+  /// \brief Get the defined functions, one per address
+  ///
+  /// \return The functions, sorted by address
+  virtual ::std::vector< component::Symbol > functions(void) const = 0;
 
 public:
   /// \brief Is NX enabled
@@ -177,6 +183,11 @@ public:
   /// \return true if PIE, else false
   virtual bool pie(void) const = 0;
 
+  /// \brief Get the GNU build-id
+  ///
+  /// \return The build-id, empty if the binary has none
+  virtual ::std::string_view build_id(void) const = 0;
+
 public:
   /// \brief Get mapped address of a symbol
   ///
@@ -193,16 +204,49 @@ public:
   virtual ::std::optional< uintarch_t > get_address(
       uintarch_t address) const = 0;
 
-  /// \brief Get symbol by virtual address
+  /// \brief Get the symbol containing a virtual address
   ///
-  /// \param address Address of the symbol
+  /// Sized symbols are found by any address they cover, others by their
+  /// exact address. The offset in the symbol is address - symbol.value().
+  ///
+  /// \param address The address
   ///
   /// \return The symbol if exists, else nothing
-  virtual ::std::optional< std::reference_wrapper< const component::Symbol > >
-  get_symbol(uintarch_t address) const = 0;
+  virtual ::std::optional< component::Symbol > get_symbol(
+      uintarch_t address) const = 0;
 };
 
-/// \brief Open a binary
+/// \brief Map a binary, without parsing it
+///
+/// The kernel is asked to read the file ahead, so that the parsing does not
+/// wait on the disk.
+///
+/// \param opt Options
+/// \param path Path of the binary
+///
+/// \return A unique pointer to a Binary object, or nullptr if an error has
+/// occured
+::std::unique_ptr< Binary > map(const ::banal::Options& opt,
+                                const ::std::string& path);
+
+/// \brief Parse a binary returned by map
+///
+/// \param binary The binary
+///
+/// \return true if everything is okay, else false
+bool parse(Binary& binary);
+
+/// \brief Open a binary: map it, then parse it
+///
+/// \param opt Options
+/// \param path Path of the binary
+///
+/// \return A unique pointer to a Binary object, or nullptr if an error has
+/// occured
+::std::unique_ptr< Binary > open(const ::banal::Options& opt,
+                                 const ::std::string& path);
+
+/// \brief Open the binary given on the command line
 ///
 /// \param opt Options
 ///
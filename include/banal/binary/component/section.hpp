@@ -8,11 +8,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <string>
-#include <vector>
-
-#include "banal/binary/component/symbol.hpp"
+#include <string_view>
 
 namespace banal {
 namespace binary {
@@ -98,18 +96,6 @@ public:
   ///
   /// \return Index of the section
   inline auto index(void) const { return _index; }
-
-public:
-  /// \brief Iterator to the first symbol
-  ///
-  /// \return Iterator to the first symbol
-  virtual ::std::vector< Symbol >::const_iterator symbols_cbegin(
-      void) const = 0;
-
-  /// \brief Iterator end of the symbols
-  ///
-  /// \return Iterator end of the symbols
-  virtual ::std::vector< Symbol >::const_iterator symbols_cend(void) const = 0;
 };
 
 } // end namespace component
@@ -8,8 +8,10 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <string>
+#include <memory>
+#include <string_view>
 
 #include "banal/conf.hpp"
 
@@ -18,89 +20,253 @@ namespace binary {
 namespace component {
 
 /// Forward declaration
-class Section;
+class SymbolTable;
 
-/// \brief A symbol
+/// \brief A symbol, a handle on an entry of a symbol table
+///
+/// Handles are cheap to copy, and valid as long as their table.
 class Symbol {
 private:
-  /// \brief Index of the symbol
+  /// \brief The table
+  const SymbolTable* _table;
+
+  /// \brief Index of the symbol in the table
   ::std::size_t _index;
 
-  /// \brief Name of the symbol
-  ::std::string _name;
+public:
+  /// \brief Constructor
+  ///
+  /// \param table The table
+  /// \param index The index of the symbol in the table
+  Symbol(const SymbolTable& table, ::std::size_t index)
+      : _table(&table), _index(index) {}
+
+public:
+  /// \brief Get the index of the symbol in the table
+  ///
+  /// \return Index of the symbol
+  inline auto index(void) const { return _index; }
+
+  /// \brief Get the name of the symbol
+  ///
+  /// \return Name of the symbol
+  inline ::std::string_view name(void) const;
+
+  /// \brief Get the value of the symbol
+  ///
+  /// \return Value of the symbol
+  inline uintarch_t value(void) const;
+
+  /// \brief Get the size of the symbol
+  ///
+  /// \return Size of the symbol
+  inline ::std::size_t size(void) const;
+
+  /// \brief Get the type of the symbol
+  ///
+  /// \return Type of the symbol
+  inline ::std::uint8_t type(void) const;
+
+  /// \brief Get the index of the section which holds this symbol
+  ///
+  /// \return The index of the section which holds this symbol
+  inline ::std::uint16_t section(void) const;
+};
+
+/// \brief A symbol table, stored as a structure of arrays
+///
+/// Every array lives in a single arena, allocated once by reserve. Names are
+/// views into the string tables of the mapped binary, nothing is copied.
+class SymbolTable {
+public:
+  /// \brief Iterator over the symbols
+  class Iterator {
+  private:
+    /// \brief The table
+    const SymbolTable* _table;
 
-  /// \brief Value of the symbol
-  uintarch_t _value;
+    /// \brief Current index
+    ::std::size_t _index;
 
-  /// \brief Size of the symbol
+  public:
+    /// \brief Constructor
+    ///
+    /// \param table The table
+    /// \param index The current index
+    Iterator(const SymbolTable& table, ::std::size_t index)
+        : _table(&table), _index(index) {}
+
+    /// \brief Get the current symbol
+    ///
+    /// \return The current symbol
+    inline Symbol operator*(void) const { return Symbol(*_table, _index); }
+
+    /// \brief Move to the next symbol
+    ///
+    /// \return This iterator
+    inline Iterator& operator++(void) {
+      _index++;
+      return *this;
+    }
+
+    /// \brief Compare two iterators
+    ///
+    /// \param other The other iterator
+    ///
+    /// \return true if they differ, else false
+    inline bool operator!=(const Iterator& other) const {
+      return _index != other._index;
+    }
+  };
+
+private:
+  /// \brief Arena holding every array
+  ::std::unique_ptr<::std::uint64_t[] > _arena;
+
+  /// \brief Number of symbols
   ::std::size_t _size;
 
-  /// \brief Type
-  ::std::uint8_t _type;
+  /// \brief Maximum number of symbols
+  ::std::size_t _capacity;
+
+  /// \brief Names
+  ::std::string_view* _names;
+
+  /// \brief Values
+  uintarch_t* _values;
+
+  /// \brief Sizes
+  ::std::size_t* _sizes;
+
+  /// \brief Sections
+  ::std::uint16_t* _sections;
 
-  /// \brief Section
-  Section& _section;
+  /// \brief Types
+  ::std::uint8_t* _types;
 
 public:
   /// \brief Constructor
+  SymbolTable(void);
+
+  /// \brief Copy constructor
+  SymbolTable(const SymbolTable&) = delete;
+
+  /// \brief Copy operator=
+  SymbolTable operator=(const SymbolTable&) = delete;
+
+  /// \brief Destructor
+  ~SymbolTable(void) = default;
+
+public:
+  /// \brief Allocate the arena, dropping the symbols
+  ///
+  /// \param capacity Maximum number of symbols
+  void reserve(::std::size_t capacity);
+
+  /// \brief Add a symbol, within the capacity
   ///
-  /// \param index The index of the symbol
   /// \param name The name of the symbol
   /// \param value The value of the symbol
   /// \param size The size of the symbol
   /// \param type The type of the symbol
-  /// \param section The section which hold the symbols
-  Symbol(::std::size_t index,
-         ::std::string_view name,
-         uintarch_t value,
-         ::std::size_t size,
-         ::std::uint8_t type,
-         Section& section);
+  /// \param section The index of the section which holds the symbol
+  inline void push(::std::string_view name,
+                   uintarch_t value,
+                   ::std::size_t size,
+                   ::std::uint8_t type,
+                   ::std::uint16_t section) {
+    _names[_size] = name;
+    _values[_size] = value;
+    _sizes[_size] = size;
+    _types[_size] = type;
+    _sections[_size] = section;
+    _size++;
+  }
 
-  /// \brief Copy constructor
-  Symbol(const Symbol&) = delete;
+public:
+  /// \brief Get the number of symbols
+  ///
+  /// \return The number of symbols
+  inline auto size(void) const { return _size; }
 
-  /// \brief Copy operator=
-  Symbol operator=(const Symbol&) = delete;
+  /// \brief Get the maximum number of symbols
+  ///
+  /// \return The capacity given to reserve
+  inline auto capacity(void) const { return _capacity; }
 
-  /// \brief Move constructor
-  Symbol(Symbol&&) = default;
+  /// \brief Get a symbol
+  ///
+  /// \param i Index of the symbol
+  ///
+  /// \return The symbol
+  inline Symbol operator[](::std::size_t i) const { return Symbol(*this, i); }
 
-  /// \brief Destructor
-  ~Symbol(void) = default;
+  /// \brief Iterator to the first symbol
+  ///
+  /// \return Iterator to the first symbol
+  inline Iterator begin(void) const { return Iterator(*this, 0); }
 
-public:
-  /// \brief Get the index of the symbol
+  /// \brief Iterator end of the symbols
   ///
-  /// \return Index of the symbol
-  inline auto index(void) const { return _index; }
+  /// \return Iterator end of the symbols
+  inline Iterator end(void) const { return Iterator(*this, _size); }
 
-  /// \brief Get the name of the symbol
+  /// \brief Get the name of a symbol
   ///
-  /// \return Name of the symbol
-  inline ::std::string_view name(void) const { return _name; }
+  /// \param i Index of the symbol
+  ///
+  /// \return The name
+  inline auto name(::std::size_t i) const { return _names[i]; }
 
-  /// \brief Get the value of the symbol
+  /// \brief Get the value of a symbol
   ///
-  /// \return Value of the symbol
-  inline auto value(void) const { return _value; }
+  /// \param i Index of the symbol
+  ///
+  /// \return The value
+  inline auto value(::std::size_t i) const { return _values[i]; }
 
-  /// \brief Get the size of the symbol
+  /// \brief Get the size of a symbol
   ///
-  /// \return Size of the symbol
-  inline auto size(void) const { return _size; }
+  /// \param i Index of the symbol
+  ///
+  /// \return The size
+  inline auto size(::std::size_t i) const { return _sizes[i]; }
 
-  /// \brief Get the type of the symbol
+  /// \brief Get the type of a symbol
   ///
-  /// \return Type of the symbol
-  inline auto type(void) const { return _type; }
+  /// \param i Index of the symbol
+  ///
+  /// \return The type
+  inline auto type(::std::size_t i) const { return _types[i]; }
 
-  /// \brief Get the section which holds this symbol
+  /// \brief Get the section of a symbol
+  ///
+  /// \param i Index of the symbol
   ///
-  /// \return The section which holds this symbol
-  inline auto& section(void) const { return _section; }
+  /// \return The index of the section
+  inline auto section(::std::size_t i) const { return _sections[i]; }
 };
 
+inline ::std::string_view Symbol::name(void) const {
+  return _table->name(_index);
+}
+
+inline uintarch_t Symbol::value(void) const {
+  return _table->value(_index);
+}
+
+inline ::std::size_t Symbol::size(void) const {
+  return _table->size(_index);
+}
+
+inline ::std::uint8_t Symbol::type(void) const {
+  return _table->type(_index);
+}
+
+inline ::std::uint16_t Symbol::section(void) const {
+  return _table->section(_index);
+}
+
 } // end namespace component
 } // end namespace binary
 } // end namespace banal
@@ -0,0 +1,142 @@
+///
+/// \file
+/// \brief Persistent analysis cache specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "banal/binary/binary.hpp"
+
+namespace banal {
+
+/// \brief Kind of an artifact stored in the cache
+enum class Artifact : ::std::uint32_t {
+  Result = 1,  ///< Result record of a batch analysis
+  Summary = 2,  ///< Summaries of the functions of a binary
+  Function = 3, ///< Summary of a function, by normalized hash
+};
+
+/// \brief Content-addressed cache of analysis artifacts, in a file
+///
+/// The file starts with a fixed open addressing table, mapped in memory,
+/// followed by the artifacts, appended with pwrite and read with pread. The
+/// table never moves: a full cache stops accepting artifacts, it is never
+/// rehashed. Every access holds a fcntl lock on the file, shared for
+/// lookups and exclusive for stores, so that concurrent processes can use
+/// the same cache. Threads of a process are serialized by a mutex, since
+/// fcntl locks are owned by processes.
+class Cache {
+private:
+  /// \brief Header of the file
+  struct Header;
+
+  /// \brief Entry of the table
+  struct Entry;
+
+private:
+  /// \brief Path of the file
+  ::std::string _path;
+
+  /// \brief File descriptor
+  int _fd;
+
+  /// \brief Mapped header, followed by the table
+  Header* _header;
+
+  /// \brief Size of the mapping
+  ::std::size_t _mapped;
+
+  /// \brief Serializes the threads of this process
+  ::std::mutex _mutex;
+
+  /// \brief Tell if the cache is usable
+  bool _good;
+
+public:
+  /// \brief Constructor, opens or creates the cache
+  ///
+  /// \param path Path of the file
+  /// \param slots Number of entries of a new cache, rounded up to a power
+  /// of 2
+  Cache(const ::std::string& path, ::std::size_t slots);
+
+  /// \brief Copy constructor
+  Cache(const Cache&) = delete;
+
+  /// \brief Copy operator=
+  Cache operator=(const Cache&) = delete;
+
+  /// \brief Destructor
+  ~Cache(void);
+
+public:
+  /// \brief Compute the key of a binary
+  ///
+  /// The GNU build-id is used when the binary has one, else the whole file
+  /// is hashed.
+  ///
+  /// \param binary The binary
+  /// \param salt Hash of whatever else the artifacts depend on
+  ///
+  /// \return The key, never 0
+  static ::std::uint64_t key(const binary::Binary& binary,
+                             ::std::uint64_t salt);
+
+  /// \brief Look an artifact up
+  ///
+  /// \param key Key of the binary, or of the function
+  /// \param kind Kind of the artifact
+  ///
+  /// \return The artifact if cached, else nothing
+  ::std::optional<::std::string > lookup(::std::uint64_t key, Artifact kind);
+
+  /// \brief Store an artifact, replacing the previous one
+  ///
+  /// \param key Key of the binary, or of the function
+  /// \param kind Kind of the artifact
+  /// \param data The artifact
+  ///
+  /// \return true if stored, else false
+  bool store(::std::uint64_t key, Artifact kind, ::std::string_view data);
+
+  /// \brief Tell if the cache is usable
+  ///
+  /// \return true if it is, else false
+  inline auto good(void) const { return _good; }
+
+private:
+  /// \brief Lock the whole file
+  ///
+  /// \param type F_RDLCK, F_WRLCK or F_UNLCK
+  ///
+  /// \return true if success, else false
+  bool lock(short type);
+
+  /// \brief Create the header and the table of an empty file
+  ///
+  /// \param slots Number of entries
+  ///
+  /// \return true if success, else false
+  bool create(::std::size_t slots);
+
+  /// \brief Find the entry of an artifact, or the empty entry ending its
+  /// probe sequence
+  ///
+  /// \param key Key of the binary
+  /// \param kind Kind of the artifact
+  ///
+  /// \return The entry, or nullptr if the table is full
+  Entry* find(::std::uint64_t key, Artifact kind);
+};
+
+} // end namespace banal
@@ -12,6 +12,10 @@
 #error "You must specify an architecture size, which is either 32 or 64"
 #endif
 
+#ifndef BANAL_VERSION
+#define BANAL_VERSION "unknown"
+#endif
+
 #define ARCH_SIZE_32 32
 #define ARCH_SIZE_64 64
 
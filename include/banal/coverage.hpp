@@ -0,0 +1,62 @@
+///
+/// \file
+/// \brief Shared block coverage specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace banal {
+
+/// \brief Blocks executed by any worker
+///
+/// A fixed size map of hashed block addresses: collisions are possible, but
+/// it is lock free and does not grow.
+class Coverage {
+private:
+  /// \brief Number of entries, a power of two
+  static constexpr ::std::size_t Size = 1 << 16;
+
+  /// \brief Entries, 1 if a block hashed there has been executed
+  ::std::unique_ptr<::std::atomic<::std::uint8_t >[] > _map;
+
+public:
+  /// \brief Constructor
+  Coverage(void) : _map(new ::std::atomic<::std::uint8_t >[Size]) {
+    for (::std::size_t i = 0; i < Size; i++) {
+      _map[i].store(0, ::std::memory_order_relaxed);
+    }
+  }
+
+  /// \brief Copy constructor
+  Coverage(const Coverage&) = delete;
+
+  /// \brief Copy operator=
+  Coverage operator=(const Coverage&) = delete;
+
+  /// \brief Destructor
+  ~Coverage(void) = default;
+
+public:
+  /// \brief Add a block
+  ///
+  /// \param address Address of the block
+  ///
+  /// \return true if the block is new, else false
+  inline bool add(::std::uint64_t address) {
+    auto& entry = _map[((address * 0x9e3779b97f4a7c15ULL) >> 32) & (Size - 1)];
+    if (entry.load(::std::memory_order_relaxed)) {
+      // fast path: already known
+      return false;
+    }
+    return entry.exchange(1, ::std::memory_order_relaxed) == 0;
+  }
+};
+
+} // end namespace banal
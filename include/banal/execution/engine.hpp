@@ -9,14 +9,23 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 #include <capstone/capstone.h>
 #include <unicorn/unicorn.h>
 
 #include "banal/binary/binary.hpp"
+#include "banal/execution/input.hpp"
+#include "banal/execution/insn_cache.hpp"
 #include "banal/execution/map.hpp"
+#include "banal/execution/observer.hpp"
+#include "banal/execution/regions.hpp"
+#include "banal/execution/shadow.hpp"
+#include "banal/execution/snapshot.hpp"
 #include "banal/execution/stack.hpp"
+#include "banal/execution/tracer.hpp"
+#include "banal/options.hpp"
 
 namespace banal {
 namespace execution {
@@ -30,6 +39,83 @@ struct State {
   ::std::uint64_t end;
 };
 
+/// \brief Memory whose writes are hooked
+struct Watch {
+  enum : ::std::uint8_t {
+    None = 0,        ///< Only code, to keep decoded instructions valid
+    Stack = 1 << 0,  ///< The stack
+    Data = 1 << 1,   ///< Writable memory besides the stack: data, bss, heap
+    Shadow = 1 << 2, ///< The stack, writes are checked against its shadow
+    Frames = 1 << 3, ///< The stack, writes are checked against the frames
+  };
+};
+
+/// \brief Get the memory to watch for the checks asked by the user
+///
+/// \param opt Options from the command line
+///
+/// \return The memory to watch (see Watch)
+inline ::std::uint8_t checks(const Options& opt) {
+  return static_cast<::std::uint8_t >((opt.shadow() ? Watch::Shadow : 0) |
+                                      (opt.frames() ? Watch::Frames : 0));
+}
+
+/// \brief How a run ended
+enum class Termination {
+  Return,   ///< main returned
+  Exit,     ///< The program called exit
+  Budget,   ///< The budget has been exhausted
+  Fault,    ///< The emulation failed (invalid memory access, invalid insn)
+  Smash,    ///< A return address has been overwritten
+  Overflow, ///< A write has hit a return address or a saved register
+  Escape    ///< A write has run past a frame, into the frame of its caller
+};
+
+/// \brief Outcome of a run
+struct Outcome {
+  /// \brief How the run ended
+  Termination reason;
+
+  /// \brief Unicorn error, for a fault
+  ::uc_err error;
+
+  /// \brief Program counter, for a fault, an overflow or an escape, or the
+  /// return, for a smash
+  uintarch_t pc;
+
+  /// \brief Exit code, value returned by main, address returned to, for a
+  /// smash, poisoned slot hit, for an overflow, or number of bytes written
+  /// past the frame, for an escape
+  uintarch_t code;
+
+  /// \brief Function whose frame has been overwritten, for a smash, an
+  /// overflow or an escape
+  uintarch_t frame;
+
+  /// \brief Caller of that function, whose frame has been written, for an
+  /// escape
+  uintarch_t caller;
+};
+
+/// \brief A frame of the shadow call stack
+///
+/// The frame spans from the stack pointer of the called function up to its
+/// return address, included.
+struct Frame {
+  /// \brief Return address pushed by the call
+  uintarch_t ret;
+
+  /// \brief Address of the return address
+  uintarch_t sp;
+
+  /// \brief Called function
+  uintarch_t callee;
+
+  /// \brief End of the highest write over the return address, 0 if it has
+  /// not been written since the call
+  uintarch_t reach;
+};
+
 class Engine {
 private:
   /// \brief Unicorn handler
@@ -44,22 +130,99 @@ private:
   /// \brief Binary
   ::banal::binary::Binary& _binary;
 
+  /// \brief Decoded instructions
+  InsnCache _cache;
+
   /// \brief Mapped memory
-  ::std::vector< Map > _mem;
+  Regions _mem;
 
-  /// \brief Stacks
-  ::std::vector< Stack > _stacks;
+  /// \brief Initial stack, laid out by prepare
+  Stack _stack;
+
+  /// \brief Auxiliary vector, pairs of type and value, without AT_RANDOM,
+  /// AT_PLATFORM, AT_EXECFN and AT_NULL
+  ::std::vector< uintarch_t > _auxv;
 
   /// \brief State
   struct State _state;
 
+  /// \brief Instrumentation granularity of traces
+  Instrumentation _mode;
+
+  /// \brief Registered hooks
+  ::std::vector<::uc_hook > _hooks;
+
+  /// \brief Registered write hooks, also in _hooks
+  ::std::vector<::uc_hook > _write_hooks;
+
+  /// \brief Memory whose writes are hooked (see Watch)
+  ::std::uint8_t _watch;
+
+  /// \brief Observers
+  ::std::vector< Observer* > _observers;
+
+  /// \brief Tracer, if any
+  Tracer* _tracer;
+
+  /// \brief Buffer used to decode blocks
+  ::std::vector<::std::uint8_t > _buffer;
+
+  /// \brief Content served on the standard input
+  ::std::vector<::std::uint8_t > _input;
+
+  /// \brief Number of bytes of the standard input already read
+  ::std::size_t _input_offset;
+
+  /// \brief Maximum number of blocks of a run (0 means no limit)
+  ::std::size_t _budget;
+
+  /// \brief Number of blocks executed by the current run
+  ::std::size_t _blocks;
+
+  /// \brief Outcome of the last run
+  Outcome _outcome;
+
+  /// \brief Unicorn stack pointer register
+  int _sp;
+
+  /// \brief Capstone stack pointer register
+  ::std::uint32_t _cs_sp;
+
+  /// \brief Flags of the last instruction of the previous block
+  ::std::uint8_t _exit;
+
+  /// \brief Address of the last instruction of the previous block
+  uintarch_t _exit_site;
+
+  /// \brief Address following the previous block, where a call returns
+  uintarch_t _exit_next;
+
+  /// \brief Shadow call stack, one frame per call not returned yet, by call
+  /// depth: addresses decrease from a frame to the next
+  ::std::vector< Frame > _frames;
+
+  /// \brief Shadow memory of the stack, used when it is watched with
+  /// Watch::Shadow
+  Shadow _shadow;
+
+  /// \brief Slots of the registers saved by the first block of the
+  /// function just called, poisoned once it has run
+  ::std::vector< uintarch_t > _saved;
+
+  /// \brief Tell if the engine is ready to emulate
+  bool _good;
+
 public:
   /// \brief Constructor
   ///
   /// \param engine Execution engine
   /// \param csh Capstone engine
   /// \param binary Binary
-  Engine(::uc_engine* engine, ::csh csh, ::banal::binary::Binary& binary);
+  /// \param mode Instrumentation granularity of traces
+  Engine(::uc_engine* engine,
+         ::csh csh,
+         ::banal::binary::Binary& binary,
+         Instrumentation mode = Instrumentation::Block);
 
   /// \brief Copy constructor
   Engine(const Engine&) = delete;
@@ -68,7 +231,9 @@ public:
   Engine operator=(const Engine&) = delete;
 
   /// \brief Move constructor
-  Engine(Engine&&) = default;
+  ///
+  /// Hooks hold a pointer to the engine, it cannot be moved.
+  Engine(Engine&&) = delete;
 
   /// \brief Destructor
   ~Engine(void);
@@ -76,28 +241,309 @@ public:
 private:
   /// \brief Load a segment
   ///
+  /// \param segment The segment
+  /// \param host Reserved memory for the pages of the segment, owned by its
+  /// map, or released if an error occurs
+  ///
+  /// \return true if success, else false
+  bool load_segment(::banal::binary::component::Segment& segment,
+                    ::std::uint8_t* host);
+
+  /// \brief Decode an instruction, and put it in the cache
+  ///
+  /// \param address Address of the instruction
+  /// \param size Size of the instruction
+  ///
+  /// \return The decoded instruction, or nullptr if an error has occured
+  const Insn* decode(uintarch_t address, ::std::size_t size);
+
+  /// \brief Decode a basic block, and put it in the cache
+  ///
+  /// \param address Address of the block
+  /// \param size Size of the block
+  ///
+  /// \return The decoded block, or nullptr if an error has occured
+  const Block* decode_block(uintarch_t address, ::std::size_t size);
+
+  /// \brief Register a hook
+  ///
+  /// \param type Type of the hook (unicorn hook type)
+  /// \param callback The callback
+  /// \param begin Begin of the hooked range
+  /// \param end End of the hooked range (inclusive)
+  /// \param insn Hooked instruction (unicorn insn id), for UC_HOOK_INSN
+  ///
+  /// \return true if success, else false
+  bool add_hook(int type,
+                void* callback,
+                ::std::uint64_t begin,
+                ::std::uint64_t end,
+                int insn = 0);
+
+  /// \brief Find the map containing an address
+  ///
+  /// \param address The address
+  ///
+  /// \return The map, or nullptr if the address is not mapped
+  Map* map(::std::uint64_t address);
+
+  /// \brief Materialize the host memory of a range, on its first access
+  ///
+  /// \param address Address of the range
+  /// \param size Size of the range
+  ///
+  /// \return true if the range is reserved host memory, now registered with
+  /// unicorn, else false
+  bool fault(::std::uint64_t address, ::std::size_t size);
+
+  /// \brief Write guest memory, and mark the written pages as dirty
+  ///
+  /// \param address Guest address
+  /// \param data Data to write
+  /// \param size Size of the data
+  ///
+  /// \return true if success, else false
+  bool write(::std::uint64_t address, const void* data, ::std::size_t size);
+
+  /// \brief Emulate the system call the program is making
+  void syscall(void);
+
+  /// \brief Check a return against the shadow call stack
+  ///
+  /// Frames whose return address is below the stack pointer are gone: the
+  /// highest one is the frame being returned from, others have been left
+  /// without a return (longjmp). A return without a frame (main, or a ret
+  /// used as a jump) is not checked.
+  ///
+  /// \param target Address returned to
+  /// \param sp Stack pointer, after the return
+  ///
+  /// \return true if the return address is the one pushed by the call, else
+  /// false
+  bool check_ret(uintarch_t target, uintarch_t sp);
+
+  /// \brief Find the depth of the frame holding an address
+  ///
+  /// Addresses in the frame of the running function, most of them, are
+  /// found in constant time, others by a binary search.
+  ///
+  /// \param address The address, on the stack
+  ///
+  /// \return The number of frames ending above the address: 0 above the
+  /// frame of main, frames[depth - 1] otherwise
+  ::std::size_t depth_of(uintarch_t address) const;
+
+  /// \brief Get the function of a frame
+  ///
+  /// \param depth Depth of the frame (see depth_of)
+  ///
+  /// \return The called function of the frame, 0 for depth 0, the C
+  /// runtime calling main
+  uintarch_t function_at(::std::size_t depth) const;
+
+  /// \brief Check a write against the shadow memory of the stack
+  ///
+  /// \param address Address of the write
+  /// \param size Size of the write
+  ///
+  /// \return true if the write hits no poisoned slot, else false
+  bool check_shadow(uintarch_t address, ::std::size_t size);
+
+  /// \brief Check a write against the bounds of the frames
+  ///
+  /// A write over the return address of a frame starts a breach. A write
+  /// from the frame, or contiguous to the breach, which goes past the
+  /// return address escapes into the frame of the caller: the run stops
+  /// with Termination::Escape. Other writes to the frames of callers, such
+  /// as writes through pointers, are legitimate.
+  ///
+  /// \param address Address of the write
+  /// \param size Size of the write
+  ///
+  /// \return true if the write stays in its frame, else false
+  bool check_frames(uintarch_t address, ::std::size_t size);
+
+  /// \brief Update the shadow memory of the stack when a block is entered
+  /// through a call or a return
+  ///
+  /// The return address pushed by a call is poisoned right away. Registers
+  /// pushed by the prologue in the first block of the called function are
+  /// poisoned when the next block is entered: they are not pushed yet. Their
+  /// slots are found by following the stack pointer through the pushes and
+  /// adjustments of the block, up to its first other write or call. A return
+  /// retires the slots below the stack pointer.
+  ///
+  /// \param block The block entered
+  /// \param sp Stack pointer
+  void shadow(const Block& block, uintarch_t sp);
+
+  /// \brief Build the auxiliary vector of the binary
+  void auxv(void);
+
+  /// \brief Register the write hooks again, over the watched maps
+  ///
+  /// Writable code is always watched. The stack is watched over its whole
+  /// reserved region: it grows inside of it.
+  ///
   /// \return true if success, else false
-  bool load_segment(::banal::binary::component::Segment& segment);
+  bool scope(void);
 
 public:
-  /// \brief Emulate the code
+  /// \brief Write the input of the program: argc, argv and the standard input
+  ///
+  /// It has to be called when the emulation state is at main, typically
+  /// right after a restore.
+  ///
+  /// \param input The input
   ///
   /// \return true if success, else false
-  bool emulate(void);
+  bool prepare(const Input& input);
+
+  /// \brief Emulate the code, from main until main returns
+  ///
+  /// Calls and returns are matched on a shadow call stack: the run stops
+  /// with Termination::Smash as soon as a function returns somewhere else
+  /// than right after its call. With Watch::Shadow, it stops with
+  /// Termination::Overflow as soon as a write hits a return address or a
+  /// saved register. With Watch::Frames, it stops with Termination::Escape
+  /// as soon as a write runs past a frame into the frame of its caller.
+  ///
+  /// \param budget Maximum number of blocks to execute, 0 means no limit
+  ///
+  /// \return true if the run has ended without fault, smash, overflow nor
+  /// escape, else false
+  bool emulate(::std::size_t budget = 0);
+
+  /// \brief Get the outcome of the last run
+  ///
+  /// \return The outcome of the last run
+  inline const auto& outcome(void) const { return _outcome; }
 
   /// \brief Stop emulation
   void stop(void);
 
+  /// \brief Take a snapshot of the emulation state
+  ///
+  /// \return The snapshot, or nullptr if an error has occured
+  ::std::unique_ptr< Snapshot > snapshot(void);
+
+  /// \brief Restore the emulation state from a snapshot
+  ///
+  /// Only the pages written since the snapshot are copied back.
+  ///
+  /// \param snapshot A snapshot taken by this engine
+  ///
+  /// \return true if success, else false
+  bool restore(const Snapshot& snapshot);
+
+  /// \brief Tell if the engine is ready to emulate
+  ///
+  /// \return true if it is ready, else false
+  inline auto good(void) const { return _good; }
+
+  /// \brief Attach an observer
+  ///
+  /// \param observer The observer, it must outlive the engine
+  void attach(Observer& observer);
+
+  /// \brief Hook the writes to some memory, to check them
+  ///
+  /// Writes to memory which is not watched cost nothing: snapshots compare
+  /// it instead of relying on dirty pages.
+  ///
+  /// \param watch Memory to watch (see Watch)
+  ///
+  /// \return true if success, else false
+  bool watch(::std::uint8_t watch);
+
+  /// \brief Trace the execution: instructions (in instruction mode), blocks
+  /// and writes to writable memory, which are all watched then
+  ///
+  /// \param tracer The tracer, it must outlive the engine
+  ///
+  /// \return true if success, else false
+  bool trace(Tracer& tracer);
+
+  /// \brief Read the stack pointer
+  ///
+  /// \return The stack pointer
+  uintarch_t sp(void) const;
+
+  /// \brief Read the program counter
+  ///
+  /// \return The program counter
+  uintarch_t pc(void) const;
+
+  /// \brief Get the unicorn handler
+  ///
+  /// \return The unicorn handler
+  inline auto* uc(void) const { return _uc; }
+
+  /// \brief Get the binary
+  ///
+  /// \return The binary
+  inline auto& binary(void) const { return _binary; }
+
+  /// \brief Get the decoded instructions
+  ///
+  /// \return The decoded instructions
+  inline const auto& cache(void) const { return _cache; }
+
+  /// \brief Read guest memory in place, without copying it
+  ///
+  /// \param address Guest address
+  /// \param size Size of the range
+  ///
+  /// \return The host address of the range, or nullptr if it is not backed
+  /// by the host as a whole; uc_mem_read must be used then
+  const ::std::uint8_t* memory(::std::uint64_t address, ::std::size_t size);
+
 public:
-  /// \brief Intercept each insn
+  /// \brief Intercept each insn, when traced in instruction mode
   static void hook_insn(::uc_engine* uc,
                         ::std::uint64_t address,
                         ::std::uint32_t size,
                         void* user_data);
 
+  /// \brief Intercept each basic block
+  static void hook_block(::uc_engine* uc,
+                         ::std::uint64_t address,
+                         ::std::uint32_t size,
+                         void* user_data);
+
+  /// \brief Intercept system calls (syscall instruction)
+  static void hook_syscall(::uc_engine* uc, void* user_data);
+
+  /// \brief Intercept interrupts (int 0x80 system calls)
+  static void hook_interrupt(::uc_engine* uc,
+                             ::std::uint32_t intno,
+                             void* user_data);
+
+  /// \brief Intercept writes to watched memory
+  static void hook_write(::uc_engine* uc,
+                         ::uc_mem_type type,
+                         ::std::uint64_t address,
+                         int size,
+                         ::std::int64_t value,
+                         void* user_data);
+
+  /// \brief Intercept accesses to unmapped memory, to materialize reserved
+  /// memory
+  ///
+  /// \return true if the access can be retried, else false
+  static bool hook_unmapped(::uc_engine* uc,
+                            ::uc_mem_type type,
+                            ::std::uint64_t address,
+                            int size,
+                            ::std::int64_t value,
+                            void* user_data);
+
 private:
   /// \brief Intercept insn
   void hook_insn(uintarch_t address, ::std::size_t size);
+
+  /// \brief Intercept basic block
+  void hook_block(uintarch_t address, ::std::size_t size);
 };
 
 } // end namespace execution
@@ -0,0 +1,68 @@
+///
+/// \file
+/// \brief Capstone and Unicorn handles specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include "banal/architecture.hpp"
+#include "banal/extern/capstone.hpp"
+#include "banal/extern/unicorn.hpp"
+
+namespace banal {
+namespace execution {
+
+/// \brief Capstone and Unicorn handles, opened for an architecture
+///
+/// Handles are not thread safe: each thread owns its own.
+class Handles {
+private:
+  /// \brief Capstone handler
+  ::csh _csh;
+
+  /// \brief Unicorn handler
+  ::uc_engine* _uc;
+
+  /// \brief Tell if both handlers are opened
+  bool _good;
+
+public:
+  /// \brief Constructor
+  ///
+  /// \param architecture The architecture
+  Handles(Architecture architecture);
+
+  /// \brief Copy constructor
+  Handles(const Handles&) = delete;
+
+  /// \brief Copy operator=
+  Handles operator=(const Handles&) = delete;
+
+  /// \brief Move constructor
+  Handles(Handles&& h);
+
+  /// \brief Destructor
+  ~Handles(void);
+
+public:
+  /// \brief Get the capstone handler
+  ///
+  /// \return The capstone handler
+  inline auto csh(void) const { return _csh; }
+
+  /// \brief Get the unicorn handler
+  ///
+  /// \return The unicorn handler
+  inline auto* uc(void) const { return _uc; }
+
+  /// \brief Tell if both handlers are opened
+  ///
+  /// \return true if they are, else false
+  inline auto good(void) const { return _good; }
+};
+
+} // end namespace execution
+} // end namespace banal
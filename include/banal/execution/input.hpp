@@ -0,0 +1,28 @@
+///
+/// \file
+/// \brief Program input specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace banal {
+namespace execution {
+
+/// \brief Input of an emulated program
+struct Input {
+  /// \brief Arguments, including the program name
+  ::std::vector<::std::string > args;
+
+  /// \brief Content served to reads on the standard input
+  ::std::vector<::std::uint8_t > data;
+};
+
+} // end namespace execution
+} // end namespace banal
@@ -0,0 +1,260 @@
+///
+/// \file
+/// \brief Decoded instruction cache specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <capstone/capstone.h>
+
+namespace banal {
+namespace execution {
+
+/// \brief Instruction flags
+struct InsnFlags {
+  enum : ::std::uint8_t {
+    None = 0,             ///< Nothing special
+    Call = 1 << 0,        ///< Call
+    Ret = 1 << 1,         ///< Return
+    Jump = 1 << 2,        ///< Jump (conditional or not)
+    Store = 1 << 3,       ///< Writes memory
+    StackAdjust = 1 << 4, ///< Adds an immediate to the stack pointer
+    Save = 1 << 5,        ///< Pushes a callee-saved register
+  };
+};
+
+/// \brief A decoded instruction, as stored in the cache
+struct Insn {
+  /// \brief Guest address
+  ::std::uint64_t address;
+
+  /// \brief Offset of the text (mnemonic and operands) in the text pool
+  ::std::uint32_t text;
+
+  /// \brief Stack pointer delta, for StackAdjust
+  ::std::int32_t delta;
+
+  /// \brief Capstone instruction id
+  ::std::uint16_t id;
+
+  /// \brief Size of the instruction
+  ::std::uint8_t size;
+
+  /// \brief Flags (see InsnFlags)
+  ::std::uint8_t flags;
+};
+
+/// \brief A decoded basic block
+struct Block {
+  /// \brief Guest address
+  ::std::uint64_t address;
+
+  /// \brief Address of the last instruction
+  ::std::uint64_t last;
+
+  /// \brief Size of the block
+  ::std::uint32_t size;
+
+  /// \brief Index of the first instruction which matters
+  ::std::uint32_t first;
+
+  /// \brief Number of instructions which matter
+  ::std::uint32_t count;
+
+  /// \brief Union of the flags of the instructions
+  ::std::uint8_t flags;
+
+  /// \brief Flags of the last instruction
+  ::std::uint8_t exit;
+};
+
+/// \brief Cache of decoded instructions and basic blocks, keyed by guest
+/// address
+///
+/// Instructions are stored in a dense array, and looked up through an open
+/// addressing table. Text is stored in a single pool. A block only keeps
+/// the instructions which matter for the instrumentation (see InsnFlags).
+class InsnCache {
+private:
+  /// \brief Open addressing table, from a guest address to an index
+  class Table {
+  private:
+    /// \brief A slot of the table
+    struct Slot {
+      /// \brief Guest address
+      ::std::uint64_t address;
+
+      /// \brief Index, plus one (0 means empty)
+      ::std::uint32_t index;
+    };
+
+    /// \brief Slots, the size is a power of two
+    ::std::vector< Slot > _slots;
+
+    /// \brief Number of used slots
+    ::std::size_t _used;
+
+  public:
+    /// \brief Constructor
+    Table(void);
+
+    /// \brief Find an index
+    ///
+    /// \param address The guest address
+    ///
+    /// \return The index plus one, or 0 if not found
+    inline ::std::uint32_t find(::std::uint64_t address) const {
+      auto mask = _slots.size() - 1;
+      for (auto i = Table::hash(address) & mask;; i = (i + 1) & mask) {
+        const auto& slot = _slots[i];
+        if (slot.index == 0 || slot.address == address) {
+          return slot.index;
+        }
+      }
+    }
+
+    /// \brief Insert an index
+    ///
+    /// \param address The guest address
+    /// \param index The index
+    void insert(::std::uint64_t address, ::std::uint32_t index);
+
+    /// \brief Remove every entry
+    void clear(void);
+
+  private:
+    /// \brief Hash an address
+    ///
+    /// \param address The address
+    ///
+    /// \return The hash
+    static inline ::std::size_t hash(::std::uint64_t address) {
+      return static_cast<::std::size_t >((address * 0x9e3779b97f4a7c15ULL) >>
+                                         32);
+    }
+  };
+
+  /// \brief Instruction lookup table
+  Table _insns_table;
+
+  /// \brief Decoded instructions
+  ::std::vector< Insn > _insns;
+
+  /// \brief Text pool
+  ::std::vector< char > _text;
+
+  /// \brief Block lookup table
+  Table _blocks_table;
+
+  /// \brief Decoded blocks
+  ::std::vector< Block > _blocks;
+
+  /// \brief Instructions which matter, for all blocks
+  ::std::vector< Insn > _blocks_insns;
+
+  /// \brief Lowest cached address
+  ::std::uint64_t _low;
+
+  /// \brief Highest cached address (end of the instruction)
+  ::std::uint64_t _high;
+
+public:
+  /// \brief Constructor
+  InsnCache(void);
+
+  /// \brief Copy constructor
+  InsnCache(const InsnCache&) = delete;
+
+  /// \brief Copy operator=
+  InsnCache operator=(const InsnCache&) = delete;
+
+  /// \brief Move constructor
+  InsnCache(InsnCache&&) = default;
+
+  /// \brief Destructor
+  ~InsnCache(void) = default;
+
+public:
+  /// \brief Find an instruction
+  ///
+  /// \param address Guest address of the instruction
+  ///
+  /// \return The instruction if cached, else nullptr
+  inline const Insn* find(::std::uint64_t address) const {
+    auto i = _insns_table.find(address);
+    return i ? &_insns[i - 1] : nullptr;
+  }
+
+  /// \brief Insert a decoded instruction
+  ///
+  /// \param insn The capstone instruction
+  /// \param flags Flags of the instruction (see InsnFlags)
+  /// \param delta Stack pointer delta
+  ///
+  /// \return The cached instruction
+  const Insn& insert(const ::cs_insn& insn,
+                     ::std::uint8_t flags,
+                     ::std::int32_t delta);
+
+  /// \brief Find a block
+  ///
+  /// \param address Guest address of the block
+  ///
+  /// \return The block if cached, else nullptr
+  inline const Block* find_block(::std::uint64_t address) const {
+    auto i = _blocks_table.find(address);
+    return i ? &_blocks[i - 1] : nullptr;
+  }
+
+  /// \brief Insert a decoded block
+  ///
+  /// \param address Guest address of the block
+  /// \param size Size of the block
+  /// \param insns Every instruction of the block, in order
+  ///
+  /// \return The cached block
+  const Block& insert_block(::std::uint64_t address,
+                            ::std::uint32_t size,
+                            const ::std::vector< Insn >& insns);
+
+  /// \brief Get the instructions which matter in a block
+  ///
+  /// \param block The block
+  ///
+  /// \return Pointer to the first instruction, there are block.count of them
+  inline const Insn* insns(const Block& block) const {
+    return _blocks_insns.data() + block.first;
+  }
+
+  /// \brief Drop every instruction and block which overlaps [begin, end)
+  ///
+  /// \param begin Begin of the range
+  /// \param end End of the range
+  void invalidate(::std::uint64_t begin, ::std::uint64_t end);
+
+  /// \brief Drop every instruction and block
+  void clear(void);
+
+  /// \brief Get the text of an instruction
+  ///
+  /// \param insn The instruction
+  ///
+  /// \return Mnemonic and operands, separated by a tabulation
+  inline const char* text(const Insn& insn) const {
+    return _text.data() + insn.text;
+  }
+
+  /// \brief Get the number of cached instructions
+  ///
+  /// \return Number of cached instructions
+  inline auto size(void) const { return _insns.size(); }
+};
+
+} // end namespace execution
+} // end namespace banal
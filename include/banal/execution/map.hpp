@@ -8,15 +8,36 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
+#include <memory>
 #include <ostream>
+#include <utility>
+#include <vector>
 
 #include <unicorn/unicorn.h>
 
+#include "banal/execution/insn_cache.hpp"
+
 namespace banal {
 namespace execution {
 
+/// \brief Size of a guest page
+constexpr ::std::size_t PageSize = 4096;
+
+/// \brief Size of the chunks host memory is materialized by, chunks are
+/// aligned on their size
+constexpr ::std::size_t ChunkSize = 16 * PageSize;
+
+/// \brief A range of guest memory
+///
+/// The memory is either owned by unicorn, or by the host and registered
+/// with uc_mem_map_ptr: then it can be read in place, without uc_mem_read.
+/// Host memory is only reserved by map(), chunks are registered with unicorn
+/// on their first access (see fault), so that unused pages cost nothing.
+/// Maps are not movable: the engine keeps them in Regions, which can split
+/// and merge them.
 class Map {
 private:
   /// \brief unicorn engine
@@ -37,6 +58,31 @@ private:
   /// \brief Is mapped
   bool _mapped;
 
+  /// \brief Decoded instruction cache to invalidate, if any
+  InsnCache* _cache;
+
+  /// \brief Dirty pages, one bit per page
+  ::std::vector<::std::uint64_t > _dirty;
+
+  /// \brief Tell if writes are hooked, so that dirty pages are known
+  bool _tracked;
+
+  /// \brief Host memory backing the map, if any, unmapped with the map
+  ::std::uint8_t* _host;
+
+  /// \brief Chunks registered with unicorn, one bit per chunk, clipped to
+  /// the map
+  ::std::vector<::std::uint64_t > _resident;
+
+  /// \brief Initial content of the map, at _source_offset; zero elsewhere
+  const ::std::uint8_t* _source;
+
+  /// \brief Offset of the initial content in the map
+  ::std::size_t _source_offset;
+
+  /// \brief Size of the initial content
+  ::std::size_t _source_size;
+
 public:
   /// \brief Constructor
   ///
@@ -44,10 +90,28 @@ public:
   /// \param address Address
   /// \param size Size
   /// \param perms Permissions
+  /// \param cache Decoded instruction cache to invalidate, if any
   Map(::uc_engine* uc,
       ::std::uint64_t address,
       ::std::size_t size,
-      ::std::uint32_t perms);
+      ::std::uint32_t perms,
+      InsnCache* cache = nullptr);
+
+  /// \brief Constructor, for host memory
+  ///
+  /// \param uc Unicorn engine
+  /// \param address Address
+  /// \param size Size, a multiple of PageSize
+  /// \param perms Permissions
+  /// \param host Host memory, from mmap, page aligned and size bytes long;
+  /// the map takes it over
+  /// \param cache Decoded instruction cache to invalidate, if any
+  Map(::uc_engine* uc,
+      ::std::uint64_t address,
+      ::std::size_t size,
+      ::std::uint32_t perms,
+      ::std::uint8_t* host,
+      InsnCache* cache = nullptr);
 
   /// \brief Copy constructor
   Map(const Map&) = delete;
@@ -56,11 +120,18 @@ public:
   Map operator=(const Map&) = delete;
 
   /// \brief Move constructor
-  Map(Map&& m);
+  Map(Map&&) = delete;
 
   /// \brief Destructor
   ~Map(void);
 
+private:
+  /// \brief Constructor, takes the end of a map over
+  ///
+  /// \param m The map
+  /// \param offset Offset of the end in the map, a multiple of PageSize
+  Map(Map& m, ::std::size_t offset);
+
 public:
   /// \brief Get the address
   ///
@@ -87,11 +158,177 @@ public:
   /// \return true if it is mapped, else false
   inline auto mapped(void) const { return _mapped; }
 
+  /// \brief Get guest memory in place
+  ///
+  /// \param address Guest address
+  /// \param size Size of the range
+  ///
+  /// \return The host address of the range, or nullptr if the map is not
+  /// backed by the host or does not contain the whole range
+  inline ::std::uint8_t* host(::std::uint64_t address,
+                              ::std::size_t size) const {
+    if (!_host || address < _address || address - _address > _size ||
+        size > _size - (address - _address)) {
+      return nullptr;
+    }
+    return _host + (address - _address);
+  }
+
+  /// \brief Tell if the map is materialized on demand
+  ///
+  /// \return true if it is backed by the host, else false
+  inline auto lazy(void) const { return _host != nullptr; }
+
+  /// \brief Get the number of chunks
+  ///
+  /// \return Number of chunks
+  inline auto chunks(void) const {
+    return static_cast<::std::size_t >((_address + _size + ChunkSize - 1) /
+                                           ChunkSize -
+                                       _address / ChunkSize);
+  }
+
+  /// \brief Get the chunk containing an offset
+  ///
+  /// \param offset Offset in the map
+  ///
+  /// \return Index of the chunk in the map
+  inline auto chunk_of(::std::size_t offset) const {
+    return static_cast<::std::size_t >((_address + offset) / ChunkSize -
+                                       _address / ChunkSize);
+  }
+
+  /// \brief Get the part of a chunk in the map
+  ///
+  /// \param chunk Index of the chunk in the map
+  ///
+  /// \return Offset in the map and size of the part
+  inline ::std::pair<::std::size_t, ::std::size_t > chunk(
+      ::std::size_t chunk) const {
+    ::std::uint64_t begin = (_address / ChunkSize + chunk) * ChunkSize;
+    ::std::uint64_t end = begin + ChunkSize;
+    begin = ::std::max(begin, _address) - _address;
+    end = ::std::min(end, _address + _size) - _address;
+    return {static_cast<::std::size_t >(begin),
+            static_cast<::std::size_t >(end - begin)};
+  }
+
+  /// \brief Tell if a chunk is registered with unicorn
+  ///
+  /// \param chunk Index of the chunk in the map
+  ///
+  /// \return true if it is, else false
+  inline bool resident(::std::size_t chunk) const {
+    return !_host || ((_resident[chunk / 64] >> (chunk % 64)) & 1);
+  }
+
+  /// \brief Get the number of pages
+  ///
+  /// \return Number of pages
+  inline auto pages(void) const { return (_size + PageSize - 1) / PageSize; }
+
+  /// \brief Tell if a page is dirty
+  ///
+  /// \param page Index of the page in the map
+  ///
+  /// \return true if the page has been written since the last clean
+  inline bool dirty(::std::size_t page) const {
+    return (_dirty[page / 64] >> (page % 64)) & 1;
+  }
+
+  /// \brief Mark a range as dirty
+  ///
+  /// \param address Address of the write
+  /// \param size Size of the write
+  inline void mark(::std::uint64_t address, ::std::size_t size) {
+    if (address + size <= _address || address >= _address + _size) {
+      return;
+    }
+    ::std::uint64_t begin = address < _address ? 0 : address - _address;
+    ::std::uint64_t end =
+        ::std::min<::std::uint64_t >(address + size - _address, _size);
+    for (auto page = begin / PageSize; page * PageSize < end; page++) {
+      _dirty[page / 64] |= 1ULL << (page % 64);
+    }
+  }
+
+  /// \brief Forget dirty pages
+  void clean(void);
+
+  /// \brief Tell if writes are hooked, so that dirty pages are known
+  ///
+  /// Else, only the writes of the host are marked.
+  ///
+  /// \return true if they are, else false
+  inline auto tracked(void) const { return _tracked; }
+
+  /// \brief Tell if writes are hooked
+  ///
+  /// When tracking starts, every page is marked as dirty: writes made until
+  /// then are not known.
+  ///
+  /// \param tracked true if they are, else false
+  void track(bool tracked);
+
+  /// \brief Set the initial content of the map, zero elsewhere
+  ///
+  /// The data must outlive the map.
+  ///
+  /// \param data Initial content
+  /// \param offset Offset of the content in the map
+  /// \param size Size of the content
+  void source(const ::std::uint8_t* data,
+              ::std::size_t offset,
+              ::std::size_t size);
+
+  /// \brief Give a range of host memory its initial content back
+  ///
+  /// \param offset Offset of the range in the map
+  /// \param size Size of the range
+  void reset(::std::size_t offset, ::std::size_t size);
+
+  /// \brief Register the chunks overlapping a range with unicorn
+  ///
+  /// \param address Address of the range
+  /// \param size Size of the range
+  ///
+  /// \return true if the map is host memory containing the address and the
+  /// chunks are registered, else false
+  bool fault(::std::uint64_t address, ::std::size_t size);
+
+  /// \brief Split the map in two
+  ///
+  /// Unicorn regions are split as well, so that each belongs to one map.
+  ///
+  /// \param offset Where to split, a multiple of PageSize inside the map
+  ///
+  /// \return The end of the map, from offset
+  ::std::unique_ptr< Map > split(::std::size_t offset);
+
+  /// \brief Split the unicorn regions of the map at an offset
+  ///
+  /// \param offset Where to split, a multiple of PageSize inside the map
+  ///
+  /// \return true if success, else false
+  bool cut(::std::size_t offset);
+
+  /// \brief Tell if the next map can be merged into this one
+  ///
+  /// \param next The map right after this one
+  ///
+  /// \return true if it has the same permissions and backing, else false
+  bool mergeable(const Map& next) const;
+
+  /// \brief Merge the next map into this one, which must be mergeable
+  ///
+  /// \param next The map right after this one, left empty
+  void merge(Map& next);
+
 public:
   /// \brief Unmap the address
   void unmap(void);
 
-  /// \brief Map the address
+  /// \brief Map the address, or only reserve it for host memory
   void map(void);
 
   /// \brief Protect
@@ -0,0 +1,55 @@
+///
+/// \file
+/// \brief Execution observer specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include "banal/conf.hpp"
+#include "banal/execution/insn_cache.hpp"
+
+namespace banal {
+namespace execution {
+
+// Forward declaration
+class Engine;
+
+/// \brief Receives the events of an execution engine
+///
+/// Events are dispatched once per basic block, except writes. A call or a
+/// return is reported when the next block is entered, so that the stack
+/// pointer and the target are known.
+class Observer {
+public:
+  /// \brief Destructor
+  virtual ~Observer(void) {}
+
+public:
+  /// \brief A basic block is about to be executed
+  ///
+  /// \param engine The engine
+  /// \param block The decoded block
+  virtual void on_block(Engine&, const Block&) {}
+
+  /// \brief A call has been executed
+  ///
+  /// \param engine The engine
+  /// \param site Address of the call instruction
+  /// \param target Address of the callee
+  /// \param sp Stack pointer, it points to the return address
+  virtual void on_call(Engine&, uintarch_t, uintarch_t, uintarch_t) {}
+
+  /// \brief A return has been executed
+  ///
+  /// \param engine The engine
+  /// \param site Address of the return instruction
+  /// \param target Address the code returned to
+  /// \param sp Stack pointer, after the return address has been popped
+  virtual void on_ret(Engine&, uintarch_t, uintarch_t, uintarch_t) {}
+};
+
+} // end namespace execution
+} // end namespace banal
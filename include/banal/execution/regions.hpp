@@ -0,0 +1,134 @@
+///
+/// \file
+/// \brief Memory regions specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+
+#include "banal/execution/map.hpp"
+
+namespace banal {
+namespace execution {
+
+/// \brief Memory maps of an engine, by address
+///
+/// Maps never overlap, so that they can be kept in a tree by their first
+/// address: finding the map containing an address is logarithmic. Parts of
+/// maps can be protected or unmapped: maps are split at the bounds of the
+/// range, then adjacent maps with the same permissions and backing are
+/// merged back, which keeps the maps, and unicorn regions, few.
+class Regions {
+private:
+  /// \brief Maps, by first address
+  using Container = ::std::map<::std::uint64_t, ::std::unique_ptr< Map > >;
+
+private:
+  /// \brief Maps
+  Container _maps;
+
+public:
+  /// \brief Constructor
+  Regions(void) = default;
+
+  /// \brief Copy constructor
+  Regions(const Regions&) = delete;
+
+  /// \brief Copy operator=
+  Regions operator=(const Regions&) = delete;
+
+  /// \brief Destructor, unmaps every map
+  ~Regions(void) = default;
+
+public:
+  /// \brief Add a map, merged with its neighbours if possible
+  ///
+  /// \param map The map, mapped
+  ///
+  /// \return The map holding it, or nullptr if it is not good or overlaps
+  /// another map
+  Map* add(::std::unique_ptr< Map > map);
+
+  /// \brief Find the map containing an address
+  ///
+  /// \param address The address
+  ///
+  /// \return The map, or nullptr if the address is not mapped
+  Map* find(::std::uint64_t address) const;
+
+  /// \brief Change the permissions of a range
+  ///
+  /// \param address Address of the range, a multiple of PageSize
+  /// \param size Size of the range, a multiple of PageSize
+  /// \param perms New permissions
+  ///
+  /// \return true if success, else false
+  bool protect(::std::uint64_t address,
+               ::std::size_t size,
+               ::std::uint32_t perms);
+
+  /// \brief Unmap a range
+  ///
+  /// \param address Address of the range, a multiple of PageSize
+  /// \param size Size of the range, a multiple of PageSize
+  ///
+  /// \return true if success, else false
+  bool unmap(::std::uint64_t address, ::std::size_t size);
+
+  /// \brief Get the number of maps
+  ///
+  /// \return Number of maps
+  inline auto size(void) const { return _maps.size(); }
+
+  /// \brief Get an iterator on the first map
+  ///
+  /// \return Iterator on the first map
+  inline auto begin(void) { return _maps.begin(); }
+
+  /// \brief Get an iterator past the last map
+  ///
+  /// \return Iterator past the last map
+  inline auto end(void) { return _maps.end(); }
+
+  /// \brief Get a const iterator on the first map
+  ///
+  /// \return Const iterator on the first map
+  inline auto cbegin(void) const { return _maps.cbegin(); }
+
+  /// \brief Get a const iterator past the last map
+  ///
+  /// \return Const iterator past the last map
+  inline auto cend(void) const { return _maps.cend(); }
+
+private:
+  /// \brief Check that a range is page aligned and entirely mapped
+  ///
+  /// \param address Address of the range
+  /// \param size Size of the range
+  ///
+  /// \return true if it is, else false
+  bool covered(::std::uint64_t address, ::std::size_t size) const;
+
+  /// \brief Split the map containing an address, so that a map starts there
+  ///
+  /// \param address The address
+  ///
+  /// \return true if success, else false
+  bool split(::std::uint64_t address);
+
+  /// \brief Merge the mergeable maps overlapping a range, and their
+  /// neighbours
+  ///
+  /// \param address Address of the range
+  /// \param size Size of the range
+  void coalesce(::std::uint64_t address, ::std::size_t size);
+};
+
+} // end namespace execution
+} // end namespace banal
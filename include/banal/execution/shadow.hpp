@@ -0,0 +1,119 @@
+///
+/// \file
+/// \brief Stack shadow memory specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "banal/conf.hpp"
+
+namespace banal {
+namespace execution {
+
+/// \brief What a poisoned stack slot holds
+struct Poison {
+  enum : ::std::uint8_t {
+    None = 0,      ///< Nothing, the slot may be written
+    Return = 0xf1, ///< A return address
+    Saved = 0xf2,  ///< A register saved by a prologue
+  };
+};
+
+/// \brief Shadow memory of the stack, one byte per slot
+///
+/// Like the shadow memory of AddressSanitizer, a byte tells whether a slot
+/// of the stack may be written: 0 if it may, else what it holds (see
+/// Poison). A slot is a word, the granularity of return addresses and saved
+/// registers. Slots are poisoned when frames are built and cleared when they
+/// are left. Since the stack grows downwards, every poisoned slot is above
+/// the lowest one: writes below it, most of them, are checked with a single
+/// comparison. Others are checked 16 slots at a time.
+class Shadow {
+private:
+  /// \brief Address of the first slot
+  uintarch_t _address;
+
+  /// \brief Number of slots
+  ::std::size_t _slots;
+
+  /// \brief Shadow bytes, reserved: pages are allocated when touched
+  ::std::uint8_t* _data;
+
+  /// \brief No slot below this one is poisoned
+  ::std::size_t _low;
+
+public:
+  /// \brief Size of a slot
+  static constexpr ::std::size_t Slot = sizeof(uintarch_t);
+
+public:
+  /// \brief Constructor
+  ///
+  /// \param address Address of the stack
+  /// \param size Size of the stack, a multiple of Slot
+  Shadow(uintarch_t address, ::std::size_t size);
+
+  /// \brief Copy constructor
+  Shadow(const Shadow&) = delete;
+
+  /// \brief Copy operator=
+  Shadow operator=(const Shadow&) = delete;
+
+  /// \brief Destructor
+  ~Shadow(void);
+
+public:
+  /// \brief Poison slots
+  ///
+  /// \param address Address of the first slot
+  /// \param count Number of slots
+  /// \param kind What they hold (see Poison)
+  void poison(uintarch_t address, ::std::size_t count, ::std::uint8_t kind);
+
+  /// \brief Clear the slots below an address, they are not part of a frame
+  /// anymore
+  ///
+  /// \param address The address
+  void retire(uintarch_t address);
+
+  /// \brief Clear every slot
+  void clear(void);
+
+  /// \brief Check a write against the poisoned slots
+  ///
+  /// \param address Address of the write
+  /// \param size Size of the write
+  ///
+  /// \return The address of the first poisoned slot hit, or nothing
+  ::std::optional< uintarch_t > check(uintarch_t address,
+                                      ::std::size_t size) const;
+
+  /// \brief Tell if the shadow memory has been reserved
+  ///
+  /// \return true if it has, else false
+  inline auto good(void) const { return _data != nullptr; }
+
+private:
+  /// \brief Get the slot of an address, which may be out of the stack
+  ///
+  /// \param address The address
+  ///
+  /// \return Index of the slot, _slots if the address is above the stack
+  inline ::std::size_t slot(uintarch_t address) const {
+    if (address < _address) {
+      return 0;
+    }
+    auto i = static_cast<::std::size_t >(address - _address) / Slot;
+    return i < _slots ? i : _slots;
+  }
+};
+
+} // end namespace execution
+} // end namespace banal
@@ -0,0 +1,94 @@
+///
+/// \file
+/// \brief Emulation snapshot specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <unicorn/unicorn.h>
+
+#include "banal/execution/map.hpp"
+#include "banal/execution/regions.hpp"
+
+namespace banal {
+namespace execution {
+
+/// \brief Snapshot of the emulation state: CPU context, and content of the
+/// writable memory maps
+///
+/// Maps keep track of the pages written since the snapshot, a restore only
+/// copies these pages back; pages of maps whose writes are not hooked are
+/// compared to the snapshot instead. Only the resident chunks of host memory
+/// are saved: the others have their initial content, given back by
+/// Map::reset.
+class Snapshot {
+private:
+  /// \brief Saved content of a writable map
+  struct Image {
+    /// \brief Address of the map
+    ::std::uint64_t address;
+
+    /// \brief Content of the map, or of its resident chunks
+    ::std::vector<::std::uint8_t > data;
+
+    /// \brief Offset of each chunk in data, Unsaved if it was not resident;
+    /// empty if the whole map is saved
+    ::std::vector<::std::size_t > chunks;
+  };
+
+  /// \brief Unicorn engine
+  ::uc_engine* _uc;
+
+  /// \brief CPU context
+  ::uc_context* _context;
+
+  /// \brief Saved maps
+  ::std::vector< Image > _images;
+
+public:
+  /// \brief Constructor
+  ///
+  /// \param uc Unicorn engine
+  Snapshot(::uc_engine* uc);
+
+  /// \brief Copy constructor
+  Snapshot(const Snapshot&) = delete;
+
+  /// \brief Copy operator=
+  Snapshot operator=(const Snapshot&) = delete;
+
+  /// \brief Move constructor
+  Snapshot(Snapshot&& s);
+
+  /// \brief Destructor
+  ~Snapshot(void);
+
+public:
+  /// \brief Save the state, and clean the maps
+  ///
+  /// \param maps Memory maps of the engine
+  ///
+  /// \return true if success, else false
+  bool save(Regions& maps);
+
+  /// \brief Restore the state, and clean the maps
+  ///
+  /// \param maps Memory maps of the engine, same as given to save
+  ///
+  /// \return true if success, else false
+  bool restore(Regions& maps) const;
+
+  /// \brief Get the number of saved bytes
+  ///
+  /// \return Number of saved bytes
+  ::std::size_t size(void) const;
+};
+
+} // end namespace execution
+} // end namespace banal
@@ -9,41 +9,35 @@
 #pragma once
 
 #include <cstdint>
-#include <iomanip>
-#include <type_traits>
-#include <variant>
-
-#include <unicorn/unicorn.h>
+#include <vector>
 
 #include "banal/conf.hpp"
-#include "banal/util/log.hpp"
 
 namespace banal {
 namespace execution {
 
-/// \brief A Stack
+/// \brief Builder of the initial stack of a process
+///
+/// The stack is laid out in a host buffer, from its top down, so that the
+/// engine writes it to guest memory in a single call.
 class Stack {
-protected:
-  /// \brief Unicorn engine
-  ::uc_engine* _uc;
+private:
+  /// \brief Address of the top of the stack, right after its last byte
+  uintarch_t _top;
 
-  /// \brief Base address of the stack (top)
-  uintarch_t _base;
+  /// \brief Content, its end is at the top of the stack
+  ::std::vector<::std::uint8_t > _data;
 
-  /// \brief Size of the stack
-  ::std::size_t _size;
-
-protected:
   /// \brief Current stack pointer
   uintarch_t _sp;
 
 public:
   /// \brief Constructor
   ///
-  /// \param base The base address of the stack (bottom)
-  /// \param size Size of the stack (can be 0)
-  Stack(::uc_engine* uc, uintarch_t base, ::std::size_t size)
-      : _uc(uc), _base(base), _size(size), _sp(base) {}
+  /// \param top Address of the top of the stack
+  /// \param size Maximum size of the content
+  Stack(uintarch_t top, ::std::size_t size)
+      : _top(top), _data(size, 0), _sp(top) {}
 
   /// \brief Copy constructor
   Stack(const Stack&) = delete;
@@ -55,40 +49,30 @@ public:
   ~Stack(void) = default;
 
 public:
-  /// \brief push a value on the stack
+  /// \brief Forget the content
+  inline void clear(void) { _sp = _top; }
+
+  /// \brief Push a value on the stack
   ///
   /// \param value Value to push
   ///
   /// \return true if success, else false
   bool push(uintarch_t value);
 
-  /// \brief Pop a value from the stack
+  /// \brief Push bytes on the stack
   ///
-  /// \param value Container for the value
+  /// \param data The bytes
+  /// \param size Number of bytes
   ///
   /// \return true if success, else false
-  bool pop(uintarch_t& value);
+  bool push(const void* data, ::std::size_t size);
 
-  /// \brief Write arbitrary value on stack
+  /// \brief Align the stack pointer, downwards
   ///
-  /// \param value Value to write
-  /// \param size The size of the value to write
+  /// \param alignment Alignment, a power of 2
   ///
   /// \return true if success, else false
-  template < typename T >
-  bool write(T value, ::std::size_t size, uintarch_t at) {
-    if (auto e = ::uc_mem_write(_uc,
-                                static_cast<::std::uint64_t >(at),
-                                reinterpret_cast< const void* >(value),
-                                size);
-        e != ::UC_ERR_OK) {
-      ::banal::log::cerr() << "Unable to write data at 0x" << ::std::hex << at
-                           << " (write size: " << size
-                           << "): " << ::uc_strerror(e) << ::std::endl;
-      return false;
-    }
-    return true;
-  }
+  bool align(::std::size_t alignment);
 
 public:
   /// \brief Get the SP
@@ -96,20 +80,24 @@ public:
   /// \return Stack pointer
   inline auto sp(void) const { return _sp; }
 
-  /// \brief Set the sp
+  /// \brief Get the top of the stack
   ///
-  /// \param value New sp value
-  inline void sp(uintarch_t value) { _sp = value; }
+  /// \return Address right after the last byte of the stack
+  inline auto top(void) const { return _top; }
 
-  // \brief Get the base of the stack
+  /// \brief Get the size of the content
   ///
-  /// \return Base of the stack
-  inline auto base(void) const { return _base; }
+  /// \return Size of the content
+  inline auto size(void) const {
+    return static_cast<::std::size_t >(_top - _sp);
+  }
 
-  /// \brief Get the size of the stack
+  /// \brief Get the content, from the stack pointer
   ///
-  /// \return Size of the stack
-  inline auto size(void) const { return _size; }
+  /// \return The content
+  inline const auto* data(void) const {
+    return _data.data() + (_data.size() - this->size());
+  }
 };
 
 } // end namespace execution
@@ -0,0 +1,126 @@
+///
+/// \file
+/// \brief Execution tracer specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include <capstone/capstone.h>
+
+#include "banal/architecture.hpp"
+#include "banal/util/ring.hpp"
+
+namespace banal {
+namespace execution {
+
+/// \brief Kind of a trace record
+enum class RecordKind : ::std::uint8_t {
+  Insn,  ///< An instruction is about to be executed
+  Block, ///< A basic block is about to be executed
+  Write  ///< Memory has been written
+};
+
+/// \brief A trace record, fixed size
+struct Record {
+  /// \brief Address of the instruction or block, or written address
+  ::std::uint64_t address;
+
+  /// \brief Size of the instruction, block or write
+  ::std::uint32_t size;
+
+  /// \brief Capstone instruction id (Insn)
+  ::std::uint16_t id;
+
+  /// \brief Kind
+  RecordKind kind;
+
+  /// \brief Flags of the instruction or block (see InsnFlags)
+  ::std::uint8_t flags;
+
+  /// \brief Bytes of the instruction (Insn), decoded again when formatted
+  ::std::uint8_t bytes[16];
+};
+
+/// \brief Records events from the engine hooks into a ring buffer, and
+/// formats them on a background thread
+///
+/// Hooks only copy a record: formatting and output happen away from the
+/// emulation. Records are never dropped, a full ring makes the hook wait.
+class Tracer {
+private:
+  /// \brief Capstone handler of the background thread, to decode
+  /// instructions, 0 if it could not be opened
+  ::csh _csh;
+
+  /// \brief Instruction decoded by the background thread
+  ::cs_insn* _insn;
+
+  /// \brief Output
+  ::std::ostream& _out;
+
+  /// \brief Records
+  util::Ring< Record > _ring;
+
+  /// \brief Tell if the background thread has to keep running
+  ::std::atomic< bool > _running;
+
+  /// \brief Number of records
+  ::std::size_t _count;
+
+  /// \brief Background thread
+  ::std::thread _thread;
+
+public:
+  /// \brief Constructor, starts the background thread
+  ///
+  /// \param architecture Architecture of the traced code
+  /// \param out Output
+  /// \param capacity Capacity of the ring, in records
+  Tracer(Architecture architecture,
+         ::std::ostream& out,
+         ::std::size_t capacity = 1 << 16);
+
+  /// \brief Copy constructor
+  Tracer(const Tracer&) = delete;
+
+  /// \brief Copy operator=
+  Tracer operator=(const Tracer&) = delete;
+
+  /// \brief Destructor, flushes the remaining records
+  ~Tracer(void);
+
+public:
+  /// \brief Record an event (called from the engine thread)
+  ///
+  /// \param record The record
+  inline void push(const Record& record) {
+    while (!_ring.push(record)) {
+      ::std::this_thread::yield();
+    }
+  }
+
+  /// \brief Stop the background thread, once every record is written
+  void stop(void);
+
+private:
+  /// \brief Body of the background thread
+  void drain(void);
+
+  /// \brief Format a record
+  ///
+  /// \param record The record
+  /// \param buffer Output buffer
+  void format(const Record& record, ::std::string& buffer);
+};
+
+} // end namespace execution
+} // end namespace banal
@@ -0,0 +1,48 @@
+///
+/// \file
+/// \brief Finding specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstddef>
+
+#include "banal/conf.hpp"
+#include "banal/execution/engine.hpp"
+#include "banal/execution/input.hpp"
+#include "banal/extern/unicorn.hpp"
+
+namespace banal {
+
+/// \brief An input which made the program fault, or write over a frame
+struct Finding {
+  /// \brief Iteration which found it
+  ::std::size_t iteration;
+
+  /// \brief How the run ended: Fault, Smash, Overflow or Escape
+  execution::Termination reason;
+
+  /// \brief Program counter at the fault, or the return, for a smash
+  uintarch_t pc;
+
+  /// \brief Unicorn error, for a fault
+  ::uc_err error;
+
+  /// \brief Function whose frame has been overwritten, for a smash, an
+  /// overflow or an escape
+  uintarch_t frame;
+
+  /// \brief Caller of that function, for an escape
+  uintarch_t caller;
+
+  /// \brief Number of bytes written past the frame, for an escape
+  uintarch_t size;
+
+  /// \brief The input
+  execution::Input input;
+};
+
+} // end namespace banal
@@ -8,20 +8,51 @@
 
 #pragma once
 
+#include <mutex>
 #include <unordered_map>
-
-#include <elfio/elfio.hpp>
+#include <variant>
 
 #include "banal/binary/binary.hpp"
 #include "banal/format.hpp"
+#include "banal/impl/binary/elf/file.hpp"
+#include "banal/util/interval.hpp"
 
 namespace banal {
 namespace binary {
 
 class ELFBinary : public Binary {
 private:
-  /// \brief ELFIO reader
-  ::ELFIO::elfio _reader;
+  /// \brief Symbols of a symbol section, decoded on first use
+  struct SymbolSection {
+    /// \brief Index of the symbol section
+    ::std::uint16_t index;
+
+    /// \brief Index of its .gnu.hash section, 0 if none
+    ::std::uint16_t gnu_hash;
+
+    /// \brief Index of its .hash section, 0 if none
+    ::std::uint16_t hash;
+
+    /// \brief Tell if the symbols are decoded
+    ::std::once_flag decoded;
+
+    /// \brief The symbols
+    component::SymbolTable table;
+
+    /// \brief Tell if the symbols are indexed by name
+    ::std::once_flag named;
+
+    /// \brief Defined symbols by name, built on first lookup if the section
+    /// has no hash section (see name_index)
+    ::std::vector<::std::uint32_t > names;
+  };
+
+private:
+  /// \brief The file, read in place, in its own class
+  ::std::variant<::std::monostate, ELFFile< ELF32 >, ELFFile< ELF64 > > _file;
+
+  /// \brief Machine
+  ::std::uint16_t _machine;
 
   /// \brief Segments
   ::std::vector<::std::unique_ptr< component::Segment > > _segments;
@@ -29,12 +60,36 @@ private:
   /// \brief Sections
   ::std::vector<::std::unique_ptr< component::Section > > _sections;
 
-  /// \brief Symbols
-  ::std::unordered_map< uintarch_t, const component::Symbol& > _symbols;
+  /// \brief Symbol sections
+  ::std::vector<::std::unique_ptr< SymbolSection > > _symbols;
+
+  /// \brief Loadable segments, to their offset in the file
+  util::IntervalIndex< uintarch_t > _segment_index;
+
+  /// \brief Tell if the symbols are indexed by address
+  mutable ::std::once_flag _indexed;
+
+  /// \brief Sized symbols, by covered addresses
+  mutable util::IntervalIndex< component::Symbol > _symbol_index;
+
+  /// \brief Unsized symbols, by address
+  mutable util::IntervalIndex< component::Symbol > _label_index;
+
+  /// \brief Protects _found
+  mutable ::std::mutex _found_mutex;
+
+  /// \brief Symbols found by name, one table each, by section index in the
+  /// upper half and symbol index in the lower half
+  mutable ::std::unordered_map<::std::uint64_t,
+                               ::std::unique_ptr< component::SymbolTable > >
+      _found;
 
   /// \brief Entry
   uintarch_t _entry;
 
+  /// \brief GNU build-id, empty if none
+  ::std::string_view _build_id;
+
   /// \brief NX
   bool _nx;
 
@@ -69,6 +124,61 @@ public:
 protected:
   bool parse(void) override;
 
+private:
+  /// \brief Get the architecture of the machine
+  ///
+  /// \return The architecture, or nothing if unknown
+  ::std::optional<::banal::Architecture > machine(void) const;
+
+  /// \brief Check that the architecture is supported, log why if not
+  ///
+  /// \return true if it is, else false
+  bool check_architecture(void) const;
+
+  /// \brief Build the segments, sections and symbols of the file
+  ///
+  /// \param file The file
+  ///
+  /// \return true if everything is okay, else false
+  template < typename Class >
+  bool parse(ELFFile< Class >& file);
+
+  /// \brief Decode the symbols of a symbol section, on first call
+  ///
+  /// \param symbols The symbol section
+  ///
+  /// \return The symbols
+  const component::SymbolTable& decode(SymbolSection& symbols) const;
+
+  /// \brief Decode the symbols of a symbol section
+  ///
+  /// \param file The file
+  /// \param symbols The symbol section
+  template < typename Class >
+  void decode(const ELFFile< Class >& file, SymbolSection& symbols) const;
+
+  /// \brief Look a symbol up in a symbol section, through its hash section
+  /// if it has one, else through its name index, built on first call
+  ///
+  /// \param symbols The symbol section
+  /// \param name Name of the symbol
+  ///
+  /// \return Index of the symbol in the section, or nothing
+  ::std::optional<::std::size_t > lookup(SymbolSection& symbols,
+                                         ::std::string_view name) const;
+
+  /// \brief Get a symbol found by name, without decoding its section
+  ///
+  /// \param symbols The symbol section
+  /// \param index Index of the symbol in the section
+  ///
+  /// \return The symbol, or nothing if it cannot be read
+  ::std::optional< component::Symbol > symbol(const SymbolSection& symbols,
+                                              ::std::size_t index) const;
+
+  /// \brief Index every symbol by address
+  void index_addresses(void) const;
+
 public:
   void dump(void) const override;
   ::std::vector<::std::unique_ptr< component::Segment > >::const_iterator
@@ -79,19 +189,21 @@ public:
   sections_cbegin(void) const override;
   ::std::vector<::std::unique_ptr< component::Section > >::const_iterator
   sections_cend(void) const override;
-  const ::std::unordered_map< uintarch_t, const component::Symbol& >& symbols(
-      void) const override;
+  ::std::optional< component::Symbol > find_symbol(
+      ::std::string_view name) const override;
+  ::std::vector< component::Symbol > functions(void) const override;
 
 public:
   inline bool nx(void) const override { return _nx; }
   inline bool pie(void) const override { return _pie; }
+  inline ::std::string_view build_id(void) const override { return _build_id; }
 
 public:
   ::std::optional< uintarch_t > get_address(
       const component::Symbol& sym) const override;
   ::std::optional< uintarch_t > get_address(uintarch_t address) const override;
-  ::std::optional< std::reference_wrapper< const component::Symbol > >
-  get_symbol(uintarch_t address) const override;
+  ::std::optional< component::Symbol > get_symbol(
+      uintarch_t address) const override;
 };
 } // end namespace binary
 } // end namespace banal
@@ -8,34 +8,35 @@
 
 #pragma once
 
-#include <elfio/elfio.hpp>
-
 #include "banal/binary/component/section.hpp"
+#include "banal/impl/binary/elf/file.hpp"
 
 namespace banal {
 namespace binary {
 namespace component {
 
-/// \brief An ELF section
+/// \brief An ELF section, read in place
+template < typename Class >
 class ELFSection : public Section {
 private:
-  /// \brief The elfio section
-  ::ELFIO::section& _section;
+  /// \brief The file
+  const ELFFile< Class >& _file;
 
-  /// \brief Name of the section
-  ::std::string _name;
+  /// \brief The section header, in the mapping
+  const typename Class::Shdr& _section;
 
-  /// \brief The symbols
-  ::std::vector< Symbol > _symbols;
+  /// \brief Name of the section, in the mapping
+  ::std::string_view _name;
 
 public:
   /// \brief Constructor
   ///
+  /// \param file The file
   /// \param index Index of the section
-  /// \param sec Pointer to the elfio section object
-  ELFSection(const ::ELFIO::elfio& file,
+  /// \param sec The section header
+  ELFSection(const ELFFile< Class >& file,
              ::std::uint16_t index,
-             ::ELFIO::section* sec);
+             const typename Class::Shdr& sec);
 
   /// \brief Copy constructor
   ELFSection(const ELFSection&) = delete;
@@ -60,14 +61,6 @@ public:
   ::std::uint64_t address(void) const override;
   ::std::size_t size(void) const override;
   const ::std::uint8_t* data(void) const override;
-
-public:
-  ::std::vector< Symbol >::const_iterator symbols_cbegin(void) const override {
-    return _symbols.cbegin();
-  }
-  ::std::vector< Symbol >::const_iterator symbols_cend(void) const override {
-    return _symbols.cend();
-  }
 };
 
 } // end namespace component
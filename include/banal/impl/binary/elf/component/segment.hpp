@@ -8,26 +8,32 @@
 
 #pragma once
 
-#include <elfio/elfio.hpp>
-
 #include "banal/binary/component/segment.hpp"
+#include "banal/impl/binary/elf/file.hpp"
 
 namespace banal {
 namespace binary {
 namespace component {
 
-/// \brief An ELF segment
+/// \brief An ELF segment, read in place
+template < typename Class >
 class ELFSegment : public Segment {
 private:
-  /// \brief The elfio segment
-  const ::ELFIO::segment& _seg;
+  /// \brief The file
+  const ELFFile< Class >& _file;
+
+  /// \brief The program header, in the mapping
+  const typename Class::Phdr& _seg;
 
 public:
   /// \brief Constructor
   ///
   /// \param index Index of the segment
-  /// \param seg Pointer to the elfio segment object
-  ELFSegment(::std::uint16_t index, const ::ELFIO::segment* seg);
+  /// \param file The file
+  /// \param seg The program header
+  ELFSegment(::std::uint16_t index,
+             const ELFFile< Class >& file,
+             const typename Class::Phdr& seg);
 
   /// \brief Copy constructor
   ELFSegment(const ELFSegment&) = delete;
@@ -0,0 +1,229 @@
+///
+/// \file
+/// \brief ELF file view specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include <elfio/elf_types.hpp>
+
+namespace banal {
+namespace binary {
+
+/// \brief Structures of an ELF class
+template < typename E, typename P, typename S, typename Y >
+struct ELFClass {
+  /// \brief File header
+  using Ehdr = E;
+
+  /// \brief Program header
+  using Phdr = P;
+
+  /// \brief Section header
+  using Shdr = S;
+
+  /// \brief Symbol
+  using Sym = Y;
+};
+
+/// \brief 32 bits ELF
+using ELF32 = ELFClass<::ELFIO::Elf32_Ehdr,
+                       ::ELFIO::Elf32_Phdr,
+                       ::ELFIO::Elf32_Shdr,
+                       ::ELFIO::Elf32_Sym >;
+
+/// \brief 64 bits ELF
+using ELF64 = ELFClass<::ELFIO::Elf64_Ehdr,
+                       ::ELFIO::Elf64_Phdr,
+                       ::ELFIO::Elf64_Shdr,
+                       ::ELFIO::Elf64_Sym >;
+
+/// \brief An ELF file, read in place from its mapping
+///
+/// Nothing is copied: headers, names and data are pointers into the mapping,
+/// which has to outlive the view. Every table is bound-checked by parse,
+/// then accessed without further checks.
+template < typename Class >
+class ELFFile {
+public:
+  /// \brief File header
+  using Ehdr = typename Class::Ehdr;
+
+  /// \brief Program header
+  using Phdr = typename Class::Phdr;
+
+  /// \brief Section header
+  using Shdr = typename Class::Shdr;
+
+  /// \brief Symbol
+  using Sym = typename Class::Sym;
+
+private:
+  /// \brief Begin of the mapping
+  const ::std::uint8_t* _begin;
+
+  /// \brief Size of the mapping
+  ::std::size_t _size;
+
+  /// \brief File header
+  const Ehdr* _header;
+
+  /// \brief Program headers
+  const Phdr* _segments;
+
+  /// \brief Section headers
+  const Shdr* _sections;
+
+public:
+  /// \brief Constructor
+  ///
+  /// \param begin Begin of the mapping
+  /// \param size Size of the mapping
+  ELFFile(const ::std::uint8_t* begin, ::std::size_t size)
+      : _begin(begin),
+        _size(size),
+        _header(nullptr),
+        _segments(nullptr),
+        _sections(nullptr) {}
+
+  /// \brief Copy constructor
+  ELFFile(const ELFFile&) = delete;
+
+  /// \brief Copy operator=
+  ELFFile operator=(const ELFFile&) = delete;
+
+  /// \brief Destructor
+  ~ELFFile(void) = default;
+
+public:
+  /// \brief Locate and check the headers
+  ///
+  /// \return true if the file is consistent, else false
+  bool parse(void) {
+    if (_header = this->at< Ehdr >(0, 1); !_header) {
+      return false;
+    }
+    if (_header->e_phnum > 0 &&
+        (_header->e_phentsize != sizeof(Phdr) ||
+         !(_segments = this->at< Phdr >(_header->e_phoff,
+                                                 _header->e_phnum)))) {
+      return false;
+    }
+    if (_header->e_shnum > 0 &&
+        (_header->e_shentsize != sizeof(Shdr) ||
+         !(_sections = this->at< Shdr >(_header->e_shoff,
+                                                 _header->e_shnum)))) {
+      return false;
+    }
+    for (::std::size_t i = 0; i < this->sections(); i++) {
+      const auto& sec = _sections[i];
+      if (sec.sh_type != SHT_NOBITS && sec.sh_size > 0 &&
+          !this->data(sec.sh_offset, sec.sh_size)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// \brief Get an array of structures
+  ///
+  /// \param offset Offset of the array in the file
+  /// \param count Number of structures
+  ///
+  /// \return The array, or nullptr if out of the file or misaligned
+  template < typename T >
+  const T* at(::std::uint64_t offset, ::std::uint64_t count) const {
+    if (offset > _size || count > (_size - offset) / sizeof(T) ||
+        (reinterpret_cast<::std::uintptr_t >(_begin) + offset) % alignof(T)) {
+      return nullptr;
+    }
+    return reinterpret_cast< const T* >(_begin + offset);
+  }
+
+  /// \brief Get a range of bytes
+  ///
+  /// \param offset Offset of the range in the file
+  /// \param size Size of the range
+  ///
+  /// \return The range, or nullptr if empty or out of the file
+  const ::std::uint8_t* data(::std::uint64_t offset,
+                             ::std::uint64_t size) const {
+    if (size == 0 || offset > _size || size > _size - offset) {
+      return nullptr;
+    }
+    return _begin + offset;
+  }
+
+  /// \brief Get a string from a string table
+  ///
+  /// \param table Index of the string table section
+  /// \param offset Offset of the string in the table
+  ///
+  /// \return The string, empty if out of the table
+  ::std::string_view string(::std::size_t table,
+                            ::std::uint64_t offset) const {
+    if (table >= this->sections() || _sections[table].sh_type != SHT_STRTAB ||
+        offset >= _sections[table].sh_size) {
+      return {};
+    }
+    const auto* str = reinterpret_cast< const char* >(
+        _begin + _sections[table].sh_offset + offset);
+    auto max = static_cast<::std::size_t >(_sections[table].sh_size - offset);
+    const auto* end = static_cast< const char* >(::std::memchr(str, 0, max));
+    return {str, end ? static_cast<::std::size_t >(end - str) : max};
+  }
+
+public:
+  /// \brief Get the file header
+  ///
+  /// \return The file header
+  inline const auto& header(void) const { return *_header; }
+
+  /// \brief Get the number of segments
+  ///
+  /// \return The number of segments
+  inline ::std::size_t segments(void) const {
+    return _segments ? _header->e_phnum : 0;
+  }
+
+  /// \brief Get a program header
+  ///
+  /// \param i Index of the segment
+  ///
+  /// \return The program header
+  inline const auto& segment(::std::size_t i) const { return _segments[i]; }
+
+  /// \brief Get the number of sections
+  ///
+  /// \return The number of sections
+  inline ::std::size_t sections(void) const {
+    return _sections ? _header->e_shnum : 0;
+  }
+
+  /// \brief Get a section header
+  ///
+  /// \param i Index of the section
+  ///
+  /// \return The section header
+  inline const auto& section(::std::size_t i) const { return _sections[i]; }
+
+  /// \brief Get the name of a section
+  ///
+  /// \param sec The section header
+  ///
+  /// \return The name of the section
+  inline auto section_name(const Shdr& sec) const {
+    return this->string(_header->e_shstrndx, sec.sh_name);
+  }
+};
+
+} // end namespace binary
+} // end namespace banal
@@ -0,0 +1,232 @@
+///
+/// \file
+/// \brief ELF symbol hash tables specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "banal/impl/binary/elf/file.hpp"
+#include "banal/util/hash.hpp"
+
+#ifndef SHT_GNU_HASH
+#define SHT_GNU_HASH 0x6ffffff6
+#endif
+
+namespace banal {
+namespace binary {
+
+/// \brief Compare the name of a symbol
+///
+/// \param file The file
+/// \param symtab The symbol section
+/// \param index Index of the symbol
+/// \param name The name
+///
+/// \return true if the symbol is defined and named name, else false
+template < typename Class >
+bool symbol_is(const ELFFile< Class >& file,
+               const typename Class::Shdr& symtab,
+               ::std::size_t index,
+               ::std::string_view name) {
+  using Sym = typename Class::Sym;
+  if (index >= symtab.sh_size / sizeof(Sym)) {
+    return false;
+  }
+  const auto* syms = file.template at< Sym >(symtab.sh_offset, index + 1);
+  return syms != nullptr && syms[index].st_shndx != SHN_UNDEF &&
+         file.string(symtab.sh_link, syms[index].st_name) == name;
+}
+
+/// \brief Look a symbol up in a .gnu.hash section
+///
+/// \param file The file
+/// \param hash The .gnu.hash section
+/// \param symtab The symbol section it indexes
+/// \param name Name of the symbol
+///
+/// \return The index of the symbol, or nothing if absent
+template < typename Class >
+::std::optional<::std::size_t > gnu_hash_lookup(
+    const ELFFile< Class >& file,
+    const typename Class::Shdr& hash,
+    const typename Class::Shdr& symtab,
+    ::std::string_view name) {
+  // bloom words are as wide as addresses
+  using Word = decltype(typename Class::Ehdr().e_entry);
+  constexpr ::std::uint32_t Bits = sizeof(Word) * 8;
+
+  const auto* header = file.template at<::std::uint32_t >(hash.sh_offset, 4);
+  if (header == nullptr || header[0] == 0 || header[2] == 0) {
+    return ::std::nullopt;
+  }
+  auto nbuckets = header[0];
+  auto symoffset = header[1];
+  auto bloom_size = header[2];
+  auto bloom_shift = header[3];
+  auto words = hash.sh_size / sizeof(::std::uint32_t);
+  auto fixed = 4 + bloom_size * (sizeof(Word) / 4) +
+               static_cast<::std::size_t >(nbuckets);
+  if (words < fixed) {
+    return ::std::nullopt;
+  }
+  const auto* bloom =
+      file.template at< Word >(hash.sh_offset + 16, bloom_size);
+  const auto* buckets = file.template at<::std::uint32_t >(
+      hash.sh_offset + (fixed - nbuckets) * 4, nbuckets);
+  const auto* chain = buckets + nbuckets;
+  auto chain_size = words - fixed;
+  if (bloom == nullptr || buckets == nullptr) {
+    return ::std::nullopt;
+  }
+
+  ::std::uint32_t h = 5381;
+  for (auto c : name) {
+    h = h * 33 + static_cast< unsigned char >(c);
+  }
+  auto word = bloom[(h / Bits) % bloom_size];
+  auto mask = static_cast< Word >((Word(1) << (h % Bits)) |
+                                  (Word(1) << ((h >> bloom_shift) % Bits)));
+  if ((word & mask) != mask) {
+    return ::std::nullopt;
+  }
+  auto index = buckets[h % nbuckets];
+  if (index < symoffset) {
+    return ::std::nullopt;
+  }
+  for (; index - symoffset < chain_size; index++) {
+    auto h2 = chain[index - symoffset];
+    if ((h | 1) == (h2 | 1) && symbol_is(file, symtab, index, name)) {
+      return index;
+    }
+    if (h2 & 1) {
+      break;
+    }
+  }
+  return ::std::nullopt;
+}
+
+/// \brief Look a symbol up in a .hash section
+///
+/// \param file The file
+/// \param hash The .hash section
+/// \param symtab The symbol section it indexes
+/// \param name Name of the symbol
+///
+/// \return The index of the symbol, or nothing if absent
+template < typename Class >
+::std::optional<::std::size_t > sysv_hash_lookup(
+    const ELFFile< Class >& file,
+    const typename Class::Shdr& hash,
+    const typename Class::Shdr& symtab,
+    ::std::string_view name) {
+  const auto* header = file.template at<::std::uint32_t >(hash.sh_offset, 2);
+  if (header == nullptr || header[0] == 0) {
+    return ::std::nullopt;
+  }
+  auto nbucket = header[0];
+  auto nchain = header[1];
+  if (hash.sh_size / sizeof(::std::uint32_t) <
+      2 + static_cast<::std::uint64_t >(nbucket) + nchain) {
+    return ::std::nullopt;
+  }
+  const auto* bucket = header + 2;
+  const auto* chain = bucket + nbucket;
+
+  ::std::uint32_t h = 0;
+  for (auto c : name) {
+    h = (h << 4) + static_cast< unsigned char >(c);
+    auto g = h & 0xf0000000;
+    h ^= g >> 24;
+    h &= ~g;
+  }
+  // the chain length bounds the walk, even on a corrupted table
+  auto index = bucket[h % nbucket];
+  for (::std::uint32_t n = 0; index != 0 && index < nchain && n < nchain;
+       n++, index = chain[index]) {
+    if (symbol_is(file, symtab, index, name)) {
+      return index;
+    }
+  }
+  return ::std::nullopt;
+}
+
+/// \brief Index the defined symbols of a symbol section by name, for
+/// sections without hash section (.symtab)
+///
+/// Names are read in place, nothing is decoded.
+///
+/// \param file The file
+/// \param symtab The symbol section
+///
+/// \return Open addressing table, at most half full, of the indexes of the
+/// symbols + 1, 0 if empty
+template < typename Class >
+::std::vector<::std::uint32_t > name_index(const ELFFile< Class >& file,
+                                           const typename Class::Shdr& symtab) {
+  using Sym = typename Class::Sym;
+  auto count = static_cast<::std::size_t >(symtab.sh_size / sizeof(Sym));
+  const auto* syms = file.template at< Sym >(symtab.sh_offset, count);
+  if (symtab.sh_entsize != sizeof(Sym) || syms == nullptr) {
+    return {};
+  }
+  ::std::size_t capacity = 16;
+  while (capacity < 2 * count) {
+    capacity <<= 1;
+  }
+  ::std::vector<::std::uint32_t > names(capacity, 0);
+  auto mask = capacity - 1;
+  for (::std::size_t i = 0; i < count; i++) {
+    auto name = file.string(symtab.sh_link, syms[i].st_name);
+    if (syms[i].st_shndx == SHN_UNDEF || name.empty()) {
+      continue;
+    }
+    auto h = static_cast<::std::size_t >(
+        util::murmur64(name.data(), name.size()));
+    while (names[h & mask] != 0) {
+      h++;
+    }
+    names[h & mask] = static_cast<::std::uint32_t >(i + 1);
+  }
+  return names;
+}
+
+/// \brief Look a symbol up in a name index (see name_index)
+///
+/// \param file The file
+/// \param symtab The symbol section
+/// \param names The name index of the section
+/// \param name Name of the symbol
+///
+/// \return The index of the symbol, or nothing if absent
+template < typename Class >
+::std::optional<::std::size_t > name_index_lookup(
+    const ELFFile< Class >& file,
+    const typename Class::Shdr& symtab,
+    const ::std::vector<::std::uint32_t >& names,
+    ::std::string_view name) {
+  if (names.empty()) {
+    return ::std::nullopt;
+  }
+  auto mask = names.size() - 1;
+  auto h = static_cast<::std::size_t >(
+      util::murmur64(name.data(), name.size()));
+  for (; names[h & mask] != 0; h++) {
+    auto index = static_cast<::std::size_t >(names[h & mask] - 1);
+    if (symbol_is(file, symtab, index, name)) {
+      return index;
+    }
+  }
+  return ::std::nullopt;
+}
+
+} // end namespace binary
+} // end namespace banal
@@ -0,0 +1,74 @@
+///
+/// \file
+/// \brief Input mutator specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstdint>
+
+#include "banal/execution/input.hpp"
+
+namespace banal {
+
+/// \brief Mutates program inputs: arguments and standard input
+///
+/// Mutations are cheap and biased toward growing buffers, which is what
+/// overflows need. The generator is a xorshift64*, runs are reproducible
+/// from the seed.
+class Mutator {
+private:
+  /// \brief State of the generator
+  ::std::uint64_t _state;
+
+public:
+  /// \brief Constructor
+  ///
+  /// \param seed Seed of the generator
+  Mutator(::std::uint64_t seed);
+
+  /// \brief Copy constructor
+  Mutator(const Mutator&) = delete;
+
+  /// \brief Copy operator=
+  Mutator operator=(const Mutator&) = delete;
+
+  /// \brief Move constructor
+  Mutator(Mutator&&) = default;
+
+  /// \brief Destructor
+  ~Mutator(void) = default;
+
+public:
+  /// \brief Mutate an input
+  ///
+  /// The program name (first argument) is never modified.
+  ///
+  /// \param input The input
+  void mutate(execution::Input& input);
+
+private:
+  /// \brief Get the next random number
+  ///
+  /// \return A random number
+  ::std::uint64_t next(void);
+
+  /// \brief Get a random number in [0, n)
+  ///
+  /// \param n Upper bound, must not be 0
+  ///
+  /// \return A random number
+  ::std::size_t below(::std::size_t n);
+
+  /// \brief Apply one mutation to a buffer
+  ///
+  /// \param buffer The buffer (string or bytes)
+  /// \param text true if the buffer cannot contain NUL bytes
+  template < typename T >
+  void mutate(T& buffer, bool text);
+};
+
+} // end namespace banal
@@ -8,7 +8,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <optional>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -17,6 +19,19 @@
 
 namespace banal {
 
+/// \brief Instrumentation granularity
+enum class Instrumentation {
+  Instruction, ///< Callback on every instruction
+  Block        ///< Callback on every basic block
+};
+
+/// \brief Priority of the pending exploration jobs
+enum class Priority {
+  Depth,    ///< Most mutated inputs first
+  Coverage, ///< Children of the runs which found most new blocks first
+  Danger    ///< Children of the runs which made most dangerous calls first
+};
+
 /// \brief Options for analysis
 class Options {
 private:
@@ -26,6 +41,60 @@ private:
   /// \brief Arguments vector
   ::std::vector<::std::string > _argv;
 
+  /// \brief Instrumentation granularity
+  Instrumentation _instrumentation;
+
+  /// \brief File served on the standard input, if any
+  ::std::string _input;
+
+  /// \brief Number of mutated inputs to run
+  ::std::size_t _iterations;
+
+  /// \brief Maximum number of blocks per run
+  ::std::size_t _budget;
+
+  /// \brief Compact trace file, if any
+  ::std::string _trace_file;
+
+  /// \brief Tell if stack writes are checked against a shadow memory
+  bool _shadow;
+
+  /// \brief Tell if stack writes are checked against the bounds of frames
+  bool _frames;
+
+  /// \brief Seed of the mutator
+  ::std::uint64_t _seed;
+
+  /// \brief Number of workers
+  ::std::size_t _jobs;
+
+  /// \brief Priority of the pending jobs
+  Priority _priority;
+
+  /// \brief Binaries to analyze in batch, if any
+  ::std::string _batch;
+
+  /// \brief Number of batch workers opening and mapping binaries
+  ::std::size_t _batch_io_jobs;
+
+  /// \brief Number of batch workers parsing binaries
+  ::std::size_t _batch_parse_jobs;
+
+  /// \brief Number of batch workers running the static pre-pass
+  ::std::size_t _batch_static_jobs;
+
+  /// \brief Number of batch workers emulating binaries
+  ::std::size_t _batch_jobs;
+
+  /// \brief Number of binaries waiting between two batch stages
+  ::std::size_t _batch_depth;
+
+  /// \brief File receiving the batch results
+  ::std::string _results;
+
+  /// \brief Analysis cache file, if any
+  ::std::string _cache;
+
   /// \brief Tell if everything is okay
   bool _status;
 
@@ -56,6 +125,96 @@ public:
   /// \return The program arguments
   inline const auto& argv(void) const { return _argv; }
 
+  /// \brief Get the instrumentation granularity
+  ///
+  /// \return The instrumentation granularity
+  inline auto instrumentation(void) const { return _instrumentation; }
+
+  /// \brief Get the file served on the standard input
+  ///
+  /// \return The file path, empty if none
+  inline const auto& input(void) const { return _input; }
+
+  /// \brief Get the number of mutated inputs to run
+  ///
+  /// \return The number of iterations, 0 means a single run, no exploration
+  inline auto iterations(void) const { return _iterations; }
+
+  /// \brief Get the maximum number of blocks per run
+  ///
+  /// \return The budget, 0 means no limit
+  inline auto budget(void) const { return _budget; }
+
+  /// \brief Get the compact trace file
+  ///
+  /// \return The file path, empty if none
+  inline const auto& trace_file(void) const { return _trace_file; }
+
+  /// \brief Tell if stack writes are checked against a shadow memory
+  ///
+  /// \return true if they are, else false
+  inline auto shadow(void) const { return _shadow; }
+
+  /// \brief Tell if stack writes are checked against the bounds of frames
+  ///
+  /// \return true if they are, else false
+  inline auto frames(void) const { return _frames; }
+
+  /// \brief Get the seed of the mutator
+  ///
+  /// \return The seed
+  inline auto seed(void) const { return _seed; }
+
+  /// \brief Get the number of workers
+  ///
+  /// \return The number of workers, 0 means one per core
+  inline auto jobs(void) const { return _jobs; }
+
+  /// \brief Get the priority of the pending jobs
+  ///
+  /// \return The priority
+  inline auto priority(void) const { return _priority; }
+
+  /// \brief Get the binaries to analyze in batch
+  ///
+  /// \return A directory, a list file or "-", empty out of batch mode
+  inline const auto& batch(void) const { return _batch; }
+
+  /// \brief Get the number of batch workers opening and mapping binaries
+  ///
+  /// \return The number of workers
+  inline auto batch_io_jobs(void) const { return _batch_io_jobs; }
+
+  /// \brief Get the number of batch workers parsing binaries
+  ///
+  /// \return The number of workers
+  inline auto batch_parse_jobs(void) const { return _batch_parse_jobs; }
+
+  /// \brief Get the number of batch workers running the static pre-pass
+  ///
+  /// \return The number of workers
+  inline auto batch_static_jobs(void) const { return _batch_static_jobs; }
+
+  /// \brief Get the number of batch workers emulating binaries
+  ///
+  /// \return The number of workers, 0 means one per core
+  inline auto batch_jobs(void) const { return _batch_jobs; }
+
+  /// \brief Get the number of binaries waiting between two batch stages
+  ///
+  /// \return The depth of the queues
+  inline auto batch_depth(void) const { return _batch_depth; }
+
+  /// \brief Get the file receiving the batch results
+  ///
+  /// \return The file path, "-" for the standard output
+  inline const auto& results(void) const { return _results; }
+
+  /// \brief Get the analysis cache file
+  ///
+  /// \return The file path, empty if there is no cache
+  inline const auto& cache(void) const { return _cache; }
+
   /// \brief Tell if the parsing is okay or not
   ///
   /// \return true if no error has occured, else false
@@ -0,0 +1,153 @@
+///
+/// \file
+/// \brief Work-stealing scheduler specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "banal/execution/input.hpp"
+#include "banal/options.hpp"
+
+namespace banal {
+
+/// \brief A job: a pending state to run
+///
+/// A pending state is replayed from the snapshot at main with its input:
+/// unicorn contexts belong to one engine, they cannot move between workers.
+struct Job {
+  /// \brief Iteration
+  ::std::size_t iteration;
+
+  /// \brief Number of mutations from the input given on the command line
+  ::std::size_t depth;
+
+  /// \brief Number of new blocks found by the parent
+  ::std::size_t coverage;
+
+  /// \brief Number of dangerous calls made by the parent
+  ::std::size_t danger;
+
+  /// \brief The input
+  execution::Input input;
+};
+
+/// \brief Work-stealing scheduler
+///
+/// Each worker owns a pool of pending jobs, ordered by priority. A worker
+/// takes the best job of its own pool; an idle one steals the best job of
+/// another pool. Jobs are counted until they are done, the scheduler stops
+/// once nothing is pending nor running.
+class Scheduler {
+private:
+  /// \brief Jobs of a worker, a heap ordered by priority
+  struct Pool {
+    /// \brief Protects the jobs
+    ::std::mutex mutex;
+
+    /// \brief Jobs
+    ::std::vector< Job > jobs;
+  };
+
+  /// \brief Pools, one per worker
+  ::std::vector<::std::unique_ptr< Pool > > _pools;
+
+  /// \brief Priority
+  Priority _priority;
+
+  /// \brief Maximum number of jobs
+  ::std::size_t _limit;
+
+  /// \brief Number of jobs created
+  ::std::atomic<::std::size_t > _created;
+
+  /// \brief Number of jobs pending or running
+  ::std::atomic<::std::size_t > _pending;
+
+  /// \brief Protects _events
+  ::std::mutex _mutex;
+
+  /// \brief Signaled when a job is pushed or done
+  ::std::condition_variable _idle;
+
+  /// \brief Number of jobs pushed or done, idle workers wait for it to move
+  ::std::size_t _events;
+
+public:
+  /// \brief Constructor
+  ///
+  /// \param workers Number of workers
+  /// \param priority Priority of the jobs
+  /// \param limit Maximum number of jobs
+  Scheduler(::std::size_t workers, Priority priority, ::std::size_t limit);
+
+  /// \brief Copy constructor
+  Scheduler(const Scheduler&) = delete;
+
+  /// \brief Copy operator=
+  Scheduler operator=(const Scheduler&) = delete;
+
+  /// \brief Destructor
+  ~Scheduler(void) = default;
+
+public:
+  /// \brief Reserve an iteration for a new job
+  ///
+  /// \return The iteration, or nothing if the limit has been reached
+  ::std::optional<::std::size_t > reserve(void);
+
+  /// \brief Push a job in the pool of a worker
+  ///
+  /// \param worker The worker
+  /// \param job The job, its iteration has been reserved
+  void push(::std::size_t worker, Job job);
+
+  /// \brief Take a job: from the pool of the worker, else steal one
+  ///
+  /// It waits while other workers are running jobs, as they can push more:
+  /// it yields a few times, then sleeps until a job is pushed or done.
+  ///
+  /// \param worker The worker
+  /// \param job Container for the job
+  ///
+  /// \return true if a job has been taken, false if everything is done
+  bool pop(::std::size_t worker, Job& job);
+
+  /// \brief Tell a job taken by pop is done
+  void done(void);
+
+  /// \brief Give up: drop every pending job
+  void cancel(void);
+
+private:
+  /// \brief Compare jobs
+  ///
+  /// \param a A job
+  /// \param b Another job
+  ///
+  /// \return true if a has a lower priority than b
+  bool lower(const Job& a, const Job& b) const;
+
+  /// \brief Take the best job of a pool
+  ///
+  /// \param pool The pool
+  /// \param job Container for the job
+  ///
+  /// \return true if the pool was not empty, else false
+  bool take(Pool& pool, Job& job);
+
+  /// \brief Wake the idle workers up
+  void notify(void);
+};
+
+} // end namespace banal
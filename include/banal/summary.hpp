@@ -0,0 +1,145 @@
+///
+/// \file
+/// \brief Function summaries specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include <capstone/capstone.h>
+
+#include "banal/binary/binary.hpp"
+#include "banal/binary/component/symbol.hpp"
+
+namespace banal {
+
+/// \brief What a function summary has flagged
+struct Verdict {
+  enum : ::std::uint8_t {
+    None = 0,           ///< Nothing found
+    Indexed = 1 << 0,   ///< Writes the stack through an index register
+    Dangerous = 1 << 1, ///< Calls a function writing without bounds
+    Escapes = 1 << 2,   ///< Writes at or above its return address
+    Partial = 1 << 3,   ///< Could not be decoded entirely
+  };
+};
+
+/// \brief Summary of a function, independent of where it is loaded
+struct Summary {
+  /// \brief Bytes reserved on the stack, pushes included
+  ::std::uint32_t frame;
+
+  /// \brief Lowest byte written on the stack, relative to the stack pointer
+  /// at entry
+  ::std::int32_t low;
+
+  /// \brief Byte after the highest one written on the stack, relative to
+  /// the stack pointer at entry
+  ::std::int32_t high;
+
+  /// \brief Flags (see Verdict)
+  ::std::uint8_t verdict;
+};
+
+/// \brief Tell if a function writes memory without bounds
+///
+/// \param name Name of the function
+///
+/// \return true if it does, else false
+bool dangerous(::std::string_view name);
+
+/// \brief Hashes and summarizes the functions of a binary
+///
+/// Hashes are normalized: addresses inside the image, relative branches and
+/// rip-relative displacements are left out, and direct calls are hashed by
+/// the name of their target. Two copies of a function linked at different
+/// addresses get the same hash, whatever the binary. Only x86 is supported.
+class Summarizer {
+private:
+  /// \brief The binary
+  const binary::Binary& _binary;
+
+  /// \brief Capstone handler
+  ::csh _csh;
+
+  /// \brief Capstone instruction
+  ::cs_insn* _insn;
+
+  /// \brief Lowest loaded address
+  ::std::uint64_t _low;
+
+  /// \brief Highest loaded address
+  ::std::uint64_t _high;
+
+  /// \brief Capstone stack pointer register
+  ::std::uint32_t _sp;
+
+  /// \brief Capstone frame pointer register
+  ::std::uint32_t _bp;
+
+  /// \brief Size of a stack slot
+  ::std::uint32_t _word;
+
+  /// \brief Tell if it is good
+  bool _good;
+
+public:
+  /// \brief Constructor
+  ///
+  /// \param binary The binary, parsed
+  Summarizer(const binary::Binary& binary);
+
+  /// \brief Copy constructor
+  Summarizer(const Summarizer&) = delete;
+
+  /// \brief Copy operator=
+  Summarizer operator=(const Summarizer&) = delete;
+
+  /// \brief Destructor
+  ~Summarizer(void);
+
+public:
+  /// \brief Compute the normalized hash of a function
+  ///
+  /// \param function The function
+  ///
+  /// \return The hash, never 0, or nothing if the function is not in the
+  /// file
+  ::std::optional<::std::uint64_t > hash(const binary::component::Symbol&
+                                             function);
+
+  /// \brief Summarize a function
+  ///
+  /// \param function The function
+  ///
+  /// \return The summary, or nothing if the function is not in the file
+  ::std::optional< Summary > summarize(const binary::component::Symbol&
+                                           function);
+
+  /// \brief Tell if it is good
+  ///
+  /// \return true if it is good, else false
+  inline auto good(void) const { return _good; }
+
+private:
+  /// \brief Get the code of a function
+  ///
+  /// \param function The function
+  ///
+  /// \return The code, or nothing if the function is not in the file
+  ::std::optional<::std::string_view > code(const binary::component::Symbol&
+                                                function) const;
+
+  /// \brief Get the name of the target of a direct call
+  ///
+  /// \return The name, empty if the call is indirect or the target unknown
+  ::std::string_view callee(void) const;
+};
+
+} // end namespace banal
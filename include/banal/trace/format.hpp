@@ -0,0 +1,116 @@
+///
+/// \file
+/// \brief Trace file format specification
+///
+/// A trace file is a header, followed by a stream of unsigned LEB128
+/// varints. A varint v is:
+///  - v even: the block of id v / 2 has been executed
+///  - v odd: an entry of kind v / 2 (see Entry), followed by its fields
+///
+/// Blocks are numbered in definition order. A definition carries the
+/// address of the block, zigzag-encoded and relative to the previous
+/// definition, its size, and its bytes: traces can be disassembled without
+/// the binary.
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace banal {
+namespace trace {
+
+/// \brief Magic of a trace file
+constexpr char Magic[8] = {'B', 'N', 'L', 'T', 'R', 'A', 'C', 'E'};
+
+/// \brief Version of the format
+constexpr ::std::uint32_t Version = 1;
+
+/// \brief Header of a trace file
+struct Header {
+  /// \brief Magic
+  char magic[8];
+
+  /// \brief Version of the format
+  ::std::uint32_t version;
+
+  /// \brief Architecture of the binary (see banal::Architecture)
+  ::std::uint32_t architecture;
+
+  /// \brief Hash of the binary (murmur64)
+  ::std::uint64_t hash;
+
+  /// \brief Size of the binary
+  ::std::uint64_t size;
+};
+
+/// \brief Kinds of entries, besides block executions
+enum class Entry : ::std::uint64_t {
+  Define = 0, ///< Block definition: address delta, size, bytes
+  End = 1     ///< End of a run: termination reason, program counter
+};
+
+/// \brief Encode a varint
+///
+/// \param value The value
+/// \param out Output, at least 10 bytes
+///
+/// \return Number of bytes written
+inline ::std::size_t put_varint(::std::uint64_t value, ::std::uint8_t* out) {
+  ::std::size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = static_cast<::std::uint8_t >(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = static_cast<::std::uint8_t >(value);
+  return n;
+}
+
+/// \brief Decode a varint
+///
+/// \param p Cursor, moved after the varint
+/// \param end End of the input
+/// \param value Container for the value
+///
+/// \return true if success, false if the input is truncated
+inline bool get_varint(const ::std::uint8_t*& p,
+                       const ::std::uint8_t* end,
+                       ::std::uint64_t& value) {
+  value = 0;
+  for (unsigned shift = 0; p != end && shift < 64; shift += 7) {
+    auto byte = *p++;
+    value |= static_cast<::std::uint64_t >(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// \brief Zigzag-encode a signed delta
+///
+/// \param value The delta
+///
+/// \return The encoded delta
+inline ::std::uint64_t zigzag(::std::int64_t value) {
+  return (static_cast<::std::uint64_t >(value) << 1) ^
+         static_cast<::std::uint64_t >(value >> 63);
+}
+
+/// \brief Decode a zigzag-encoded delta
+///
+/// \param value The encoded delta
+///
+/// \return The delta
+inline ::std::int64_t unzigzag(::std::uint64_t value) {
+  return static_cast<::std::int64_t >(value >> 1) ^
+         -static_cast<::std::int64_t >(value & 1);
+}
+
+} // end namespace trace
+} // end namespace banal
@@ -0,0 +1,125 @@
+///
+/// \file
+/// \brief Trace reader specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "banal/trace/format.hpp"
+
+namespace banal {
+namespace trace {
+
+/// \brief A block defined in a trace
+struct BlockInfo {
+  /// \brief Guest address
+  ::std::uint64_t address;
+
+  /// \brief Size
+  ::std::uint64_t size;
+
+  /// \brief Bytes, inside the mapped trace
+  const ::std::uint8_t* bytes;
+};
+
+/// \brief An event read from a trace
+struct Event {
+  /// \brief Kind of an event
+  enum class Kind {
+    Block, ///< A block has been executed
+    End    ///< A run has ended
+  };
+
+  /// \brief Kind
+  Kind kind;
+
+  /// \brief Id of the block (Block)
+  ::std::uint64_t id;
+
+  /// \brief Termination reason (End, see execution::Termination)
+  ::std::uint64_t reason;
+
+  /// \brief Program counter (End)
+  ::std::uint64_t pc;
+};
+
+/// \brief Reads a trace file through a read-only mapping
+class Reader {
+private:
+  /// \brief Begin of the mapping
+  const ::std::uint8_t* _begin;
+
+  /// \brief End of the mapping
+  const ::std::uint8_t* _end;
+
+  /// \brief Cursor
+  const ::std::uint8_t* _cursor;
+
+  /// \brief Header
+  Header _header;
+
+  /// \brief Blocks defined so far
+  ::std::vector< BlockInfo > _blocks;
+
+  /// \brief Address of the last defined block
+  ::std::uint64_t _last;
+
+  /// \brief Tell if the header is valid and no error has occured
+  bool _good;
+
+public:
+  /// \brief Constructor
+  ///
+  /// \param path Path of the trace file
+  Reader(const ::std::string& path);
+
+  /// \brief Copy constructor
+  Reader(const Reader&) = delete;
+
+  /// \brief Copy operator=
+  Reader operator=(const Reader&) = delete;
+
+  /// \brief Destructor
+  ~Reader(void);
+
+public:
+  /// \brief Read the next event, block definitions are consumed
+  ///
+  /// \param event Container for the event
+  ///
+  /// \return true if an event has been read, false at the end of the trace
+  /// or on error (see good)
+  bool next(Event& event);
+
+  /// \brief Get the header
+  ///
+  /// \return The header
+  inline const auto& header(void) const { return _header; }
+
+  /// \brief Get a block defined so far
+  ///
+  /// \param id Id of the block
+  ///
+  /// \return The block
+  inline const auto& block(::std::uint64_t id) const { return _blocks[id]; }
+
+  /// \brief Get the number of blocks defined so far
+  ///
+  /// \return The number of blocks
+  inline auto blocks(void) const { return _blocks.size(); }
+
+  /// \brief Tell if no error has occured
+  ///
+  /// \return true if no error has occured, else false
+  inline auto good(void) const { return _good; }
+};
+
+} // end namespace trace
+} // end namespace banal
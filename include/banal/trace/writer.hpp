@@ -0,0 +1,93 @@
+///
+/// \file
+/// \brief Trace writer specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "banal/binary/binary.hpp"
+#include "banal/execution/engine.hpp"
+#include "banal/execution/observer.hpp"
+#include "banal/trace/format.hpp"
+
+namespace banal {
+namespace trace {
+
+/// \brief Streams executed blocks to a trace file (see format.hpp)
+class Writer : public execution::Observer {
+private:
+  /// \brief Output file
+  ::std::ofstream _out;
+
+  /// \brief Pending output
+  ::std::vector<::std::uint8_t > _buffer;
+
+  /// \brief Block ids, by address
+  ::std::unordered_map<::std::uint64_t, ::std::uint64_t > _ids;
+
+  /// \brief Bytes of a block being defined
+  ::std::vector<::std::uint8_t > _bytes;
+
+  /// \brief Address of the last defined block
+  ::std::uint64_t _last;
+
+  /// \brief Tell if the file is opened and the header written
+  bool _good;
+
+public:
+  /// \brief Constructor, writes the header
+  ///
+  /// \param path Path of the trace file
+  /// \param binary The traced binary
+  Writer(const ::std::string& path, const binary::Binary& binary);
+
+  /// \brief Copy constructor
+  Writer(const Writer&) = delete;
+
+  /// \brief Copy operator=
+  Writer operator=(const Writer&) = delete;
+
+  /// \brief Destructor, flushes the pending output
+  ~Writer(void) override;
+
+public:
+  /// \brief Record the end of a run
+  ///
+  /// \param outcome Outcome of the run
+  void end(const execution::Outcome& outcome);
+
+  /// \brief Tell if the trace can be written
+  ///
+  /// \return true if it can, else false
+  inline auto good(void) const { return _good; }
+
+public:
+  /// \brief Record a block
+  void on_block(execution::Engine& engine,
+                const execution::Block& block) override;
+
+private:
+  /// \brief Append a varint to the pending output
+  ///
+  /// \param value The value
+  inline void put(::std::uint64_t value) {
+    ::std::uint8_t bytes[10];
+    _buffer.insert(
+        _buffer.end(), bytes, bytes + put_varint(value, bytes));
+  }
+
+  /// \brief Write the pending output
+  void flush(void);
+};
+
+} // end namespace trace
+} // end namespace banal
@@ -0,0 +1,75 @@
+///
+/// \file
+/// \brief Hash functions specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace banal {
+namespace util {
+
+/// \brief MurmurHash64A
+///
+/// \param data Data to hash
+/// \param size Size of the data
+/// \param seed Seed
+///
+/// \return The hash
+inline ::std::uint64_t murmur64(const void* data,
+                                ::std::size_t size,
+                                ::std::uint64_t seed = 0) {
+  constexpr ::std::uint64_t m = 0xc6a4a7935bd1e995ULL;
+  constexpr int r = 47;
+  const auto* p = static_cast< const ::std::uint8_t* >(data);
+  ::std::uint64_t h = seed ^ (size * m);
+
+  for (const auto* end = p + (size & ~static_cast<::std::size_t >(7)); p != end;
+       p += 8) {
+    ::std::uint64_t k;
+    ::std::memcpy(&k, p, sizeof(k));
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+
+  switch (size & 7) {
+    case 7:
+      h ^= static_cast<::std::uint64_t >(p[6]) << 48;
+      [[fallthrough]];
+    case 6:
+      h ^= static_cast<::std::uint64_t >(p[5]) << 40;
+      [[fallthrough]];
+    case 5:
+      h ^= static_cast<::std::uint64_t >(p[4]) << 32;
+      [[fallthrough]];
+    case 4:
+      h ^= static_cast<::std::uint64_t >(p[3]) << 24;
+      [[fallthrough]];
+    case 3:
+      h ^= static_cast<::std::uint64_t >(p[2]) << 16;
+      [[fallthrough]];
+    case 2:
+      h ^= static_cast<::std::uint64_t >(p[1]) << 8;
+      [[fallthrough]];
+    case 1:
+      h ^= static_cast<::std::uint64_t >(p[0]);
+      h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+} // end namespace util
+} // end namespace banal
@@ -0,0 +1,140 @@
+///
+/// \file
+/// \brief Interval index specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace banal {
+namespace util {
+
+/// \brief Static index of address intervals, answering "which interval
+/// contains this address"
+///
+/// Begins are stored in Eytzinger (breadth-first) order: a lookup is a
+/// branchless descent whose first levels share a few cache lines, without
+/// any hashing. Intervals are expected to be disjoint; when two of them
+/// overlap, an address is attributed to the one starting last.
+template < typename T >
+class IntervalIndex {
+public:
+  /// \brief An interval, [begin, end)
+  struct Interval {
+    /// \brief First address
+    ::std::uint64_t begin;
+
+    /// \brief Address after the last one
+    ::std::uint64_t end;
+
+    /// \brief Value
+    T value;
+  };
+
+private:
+  /// \brief Begins, in Eytzinger order, from index 1
+  ::std::vector<::std::uint64_t > _keys;
+
+  /// \brief Rank of each key in the sorted intervals
+  ::std::vector<::std::uint32_t > _ranks;
+
+  /// \brief Intervals, sorted by begin
+  ::std::vector< Interval > _intervals;
+
+public:
+  /// \brief Constructor
+  IntervalIndex(void) : _keys(), _ranks(), _intervals() {}
+
+  /// \brief Copy constructor
+  IntervalIndex(const IntervalIndex&) = delete;
+
+  /// \brief Copy operator=
+  IntervalIndex operator=(const IntervalIndex&) = delete;
+
+  /// \brief Destructor
+  ~IntervalIndex(void) = default;
+
+public:
+  /// \brief Build the index
+  ///
+  /// \param intervals The intervals, empty ones are ignored
+  void build(::std::vector< Interval > intervals) {
+    intervals.erase(::std::remove_if(intervals.begin(),
+                                     intervals.end(),
+                                     [](const auto& i) {
+                                       return i.begin >= i.end;
+                                     }),
+                    intervals.end());
+    // sort by begin, largest first on ties, and keep one per begin
+    ::std::sort(intervals.begin(),
+                intervals.end(),
+                [](const auto& a, const auto& b) {
+                  return a.begin < b.begin ||
+                         (a.begin == b.begin && a.end > b.end);
+                });
+    intervals.erase(::std::unique(intervals.begin(),
+                                  intervals.end(),
+                                  [](const auto& a, const auto& b) {
+                                    return a.begin == b.begin;
+                                  }),
+                    intervals.end());
+    _intervals = ::std::move(intervals);
+    _keys.assign(_intervals.size() + 1, 0);
+    _ranks.assign(_intervals.size() + 1, 0);
+    ::std::size_t rank = 0;
+    this->layout(1, rank);
+  }
+
+  /// \brief Find the interval containing an address
+  ///
+  /// \param address The address
+  ///
+  /// \return The interval, or nullptr if none
+  inline const Interval* find(::std::uint64_t address) const {
+    auto n = _intervals.size();
+    ::std::size_t k = 1;
+    while (k <= n) {
+      k = 2 * k + static_cast<::std::size_t >(_keys[k] <= address);
+    }
+    // drop the trailing right turns: k is the first begin above address
+    k >>= static_cast< unsigned >(
+        __builtin_ffsll(static_cast< long long >(~k)));
+    ::std::size_t rank = k ? _ranks[k] : n;
+    if (rank == 0) {
+      return nullptr;
+    }
+    const auto& interval = _intervals[rank - 1];
+    return address < interval.end ? &interval : nullptr;
+  }
+
+  /// \brief Get the number of intervals
+  ///
+  /// \return The number of intervals
+  inline auto size(void) const { return _intervals.size(); }
+
+private:
+  /// \brief Fill the Eytzinger layout, in order
+  ///
+  /// \param k Current node
+  /// \param rank Rank of the next interval
+  void layout(::std::size_t k, ::std::size_t& rank) {
+    if (k > _intervals.size()) {
+      return;
+    }
+    this->layout(2 * k, rank);
+    _keys[k] = _intervals[rank].begin;
+    _ranks[k] = static_cast<::std::uint32_t >(rank);
+    rank++;
+    this->layout(2 * k + 1, rank);
+  }
+};
+
+} // end namespace util
+} // end namespace banal
@@ -9,6 +9,8 @@
 #pragma once
 
 #include <iostream>
+#include <sstream>
+#include <string>
 
 namespace banal {
 
@@ -89,12 +91,18 @@ namespace log {
 
 /// \brief Log stuffs
 ///
+/// The line is formatted first, then written at once to the buffered
+/// std::clog: it is not flushed, unlike std::cerr which is unit buffered.
+///
 /// \param args Stuffs
 template < typename... Options >
 void log(const Options&... args) {
-  ::std::cerr << "[DEBUG] ";
-  ((::std::cerr << args), ...);
-  ::std::cerr << ::std::endl;
+  ::std::ostringstream out;
+  out << "[DEBUG] ";
+  ((out << args), ...);
+  out << '\n';
+  auto line = out.str();
+  ::std::clog.write(line.data(), static_cast<::std::streamsize >(line.size()));
 }
 
 #else
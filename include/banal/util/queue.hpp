@@ -0,0 +1,116 @@
+///
+/// \file
+/// \brief Bounded blocking queue specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace banal {
+namespace util {
+
+/// \brief Bounded queue, for many producers and many consumers
+///
+/// A full queue blocks producers, an empty one blocks consumers until it is
+/// closed.
+template < typename T >
+class Queue {
+private:
+  /// \brief Items
+  ::std::deque< T > _items;
+
+  /// \brief Maximum number of items
+  ::std::size_t _capacity;
+
+  /// \brief Tell if the queue is closed
+  bool _closed;
+
+  /// \brief Protects the items
+  ::std::mutex _mutex;
+
+  /// \brief Signaled when an item is pushed, or the queue is closed
+  ::std::condition_variable _not_empty;
+
+  /// \brief Signaled when an item is popped, or the queue is closed
+  ::std::condition_variable _not_full;
+
+public:
+  /// \brief Constructor
+  ///
+  /// \param capacity Maximum number of items, at least 1
+  Queue(::std::size_t capacity)
+      : _items(),
+        _capacity(capacity ? capacity : 1),
+        _closed(false),
+        _mutex(),
+        _not_empty(),
+        _not_full() {}
+
+  /// \brief Copy constructor
+  Queue(const Queue&) = delete;
+
+  /// \brief Copy operator=
+  Queue operator=(const Queue&) = delete;
+
+  /// \brief Destructor
+  ~Queue(void) = default;
+
+public:
+  /// \brief Push an item, wait while the queue is full
+  ///
+  /// \param item The item
+  ///
+  /// \return true if pushed, false if the queue is closed
+  bool push(T item) {
+    {
+      ::std::unique_lock< ::std::mutex > lock(_mutex);
+      _not_full.wait(
+          lock, [this] { return _closed || _items.size() < _capacity; });
+      if (_closed) {
+        return false;
+      }
+      _items.push_back(::std::move(item));
+    }
+    _not_empty.notify_one();
+    return true;
+  }
+
+  /// \brief Pop an item, wait while the queue is empty
+  ///
+  /// \param item Container for the item
+  ///
+  /// \return true if popped, false if the queue is closed and empty
+  bool pop(T& item) {
+    {
+      ::std::unique_lock< ::std::mutex > lock(_mutex);
+      _not_empty.wait(lock, [this] { return _closed || !_items.empty(); });
+      if (_items.empty()) {
+        return false;
+      }
+      item = ::std::move(_items.front());
+      _items.pop_front();
+    }
+    _not_full.notify_one();
+    return true;
+  }
+
+  /// \brief Close the queue: pending items can still be popped
+  void close(void) {
+    {
+      ::std::lock_guard< ::std::mutex > lock(_mutex);
+      _closed = true;
+    }
+    _not_empty.notify_all();
+    _not_full.notify_all();
+  }
+};
+
+} // end namespace util
+} // end namespace banal
@@ -0,0 +1,109 @@
+///
+/// \file
+/// \brief Lock-free ring buffer specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace banal {
+namespace util {
+
+/// \brief Lock-free ring buffer, for a single producer and a single consumer
+///
+/// Indexes grow forever and are masked on access, the capacity is a power of
+/// two. Each side caches the index of the other one, and only reloads it
+/// when the ring looks full (or empty).
+template < typename T >
+class Ring {
+private:
+  /// \brief Size of a cache line
+  static constexpr ::std::size_t CacheLine = 64;
+
+  /// \brief Items
+  ::std::vector< T > _items;
+
+  /// \brief Mask of the indexes
+  ::std::size_t _mask;
+
+  /// \brief Next item to pop, written by the consumer
+  alignas(CacheLine)::std::atomic<::std::size_t > _head;
+
+  /// \brief Tail, as last seen by the consumer
+  ::std::size_t _tail_cache;
+
+  /// \brief Next item to push, written by the producer
+  alignas(CacheLine)::std::atomic<::std::size_t > _tail;
+
+  /// \brief Head, as last seen by the producer
+  ::std::size_t _head_cache;
+
+public:
+  /// \brief Constructor
+  ///
+  /// \param capacity Minimum capacity, rounded up to a power of two
+  Ring(::std::size_t capacity)
+      : _items(), _mask(0), _head(0), _tail_cache(0), _tail(0), _head_cache(0) {
+    ::std::size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    _items.resize(size);
+    _mask = size - 1;
+  }
+
+  /// \brief Copy constructor
+  Ring(const Ring&) = delete;
+
+  /// \brief Copy operator=
+  Ring operator=(const Ring&) = delete;
+
+  /// \brief Destructor
+  ~Ring(void) = default;
+
+public:
+  /// \brief Push an item (producer side)
+  ///
+  /// \param item The item
+  ///
+  /// \return true if pushed, false if the ring is full
+  inline bool push(const T& item) {
+    auto tail = _tail.load(::std::memory_order_relaxed);
+    if (tail - _head_cache == _items.size()) {
+      _head_cache = _head.load(::std::memory_order_acquire);
+      if (tail - _head_cache == _items.size()) {
+        return false;
+      }
+    }
+    _items[tail & _mask] = item;
+    _tail.store(tail + 1, ::std::memory_order_release);
+    return true;
+  }
+
+  /// \brief Pop an item (consumer side)
+  ///
+  /// \param item Container for the item
+  ///
+  /// \return true if popped, false if the ring is empty
+  inline bool pop(T& item) {
+    auto head = _head.load(::std::memory_order_relaxed);
+    if (head == _tail_cache) {
+      _tail_cache = _tail.load(::std::memory_order_acquire);
+      if (head == _tail_cache) {
+        return false;
+      }
+    }
+    item = _items[head & _mask];
+    _head.store(head + 1, ::std::memory_order_release);
+    return true;
+  }
+};
+
+} // end namespace util
+} // end namespace banal
@@ -0,0 +1,145 @@
+///
+/// \file
+/// \brief Exploration worker specification
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "banal/binary/binary.hpp"
+#include "banal/coverage.hpp"
+#include "banal/execution/engine.hpp"
+#include "banal/execution/handles.hpp"
+#include "banal/execution/observer.hpp"
+#include "banal/execution/snapshot.hpp"
+#include "banal/finding.hpp"
+#include "banal/mutator.hpp"
+#include "banal/options.hpp"
+#include "banal/scheduler.hpp"
+
+namespace banal {
+
+/// \brief Runs jobs on its own handlers and engine, with its own copy of the
+/// loaded image
+///
+/// A run spawns mutations of its input: many if it has found new blocks or
+/// made dangerous calls, one otherwise.
+class Worker : public execution::Observer {
+private:
+  /// \brief Options supplied by the user
+  const Options& _options;
+
+  /// \brief The binary
+  binary::Binary& _binary;
+
+  /// \brief Index of the worker in the scheduler
+  ::std::size_t _index;
+
+  /// \brief Blocks executed by any worker
+  Coverage& _coverage;
+
+  /// \brief Mutator
+  Mutator _mutator;
+
+  /// \brief Capstone and Unicorn handlers
+  execution::Handles _handles;
+
+  /// \brief Execution engine
+  ::std::unique_ptr< execution::Engine > _engine;
+
+  /// \brief Emulation state at main
+  ::std::unique_ptr< execution::Snapshot > _main;
+
+  /// \brief Inputs which made the program fault, one per faulting address
+  ::std::vector< Finding > _findings;
+
+  /// \brief Number of runs
+  ::std::size_t _runs;
+
+  /// \brief Number of new blocks found by the current run
+  ::std::size_t _new_blocks;
+
+  /// \brief Number of dangerous calls made by the current run
+  ::std::size_t _danger;
+
+  /// \brief Tell if the worker is ready
+  bool _good;
+
+public:
+  /// \brief Constructor
+  ///
+  /// The engine updates the binary while it is built: workers have to be
+  /// built one after the other.
+  ///
+  /// \param opt Options from the command line
+  /// \param binary The binary
+  /// \param index Index of the worker in the scheduler
+  /// \param coverage Blocks executed by any worker
+  Worker(const Options& opt,
+         binary::Binary& binary,
+         ::std::size_t index,
+         Coverage& coverage);
+
+  /// \brief Copy constructor
+  Worker(const Worker&) = delete;
+
+  /// \brief Copy operator=
+  Worker operator=(const Worker&) = delete;
+
+  /// \brief Move constructor
+  ///
+  /// The engine holds a pointer to the worker, it cannot be moved.
+  Worker(Worker&&) = delete;
+
+  /// \brief Destructor
+  ~Worker(void) override;
+
+public:
+  /// \brief Run jobs until the scheduler is done
+  ///
+  /// \param scheduler The scheduler
+  void run(Scheduler& scheduler);
+
+  /// \brief Get the findings
+  ///
+  /// \return The findings
+  inline const auto& findings(void) const { return _findings; }
+
+  /// \brief Get the number of runs
+  ///
+  /// \return The number of runs
+  inline auto runs(void) const { return _runs; }
+
+  /// \brief Tell if the worker is ready
+  ///
+  /// \return true if it is ready, else false
+  inline auto good(void) const { return _good; }
+
+public:
+  /// \brief Count new blocks
+  void on_block(execution::Engine& engine,
+                const execution::Block& block) override;
+
+  /// \brief Count dangerous calls
+  void on_call(execution::Engine& engine,
+               uintarch_t site,
+               uintarch_t target,
+               uintarch_t sp) override;
+
+private:
+  /// \brief Run a job, and push its children
+  ///
+  /// \param scheduler The scheduler
+  /// \param job The job
+  ///
+  /// \return true if the worker can go on, else false
+  bool execute(Scheduler& scheduler, const Job& job);
+};
+
+} // end namespace banal
@@ -6,16 +6,45 @@
 ///
 /// Contact: thomas at bailleux.me
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <variant>
 
 #include "banal/analysis.hpp"
 #include "banal/execution/engine.hpp"
+#include "banal/coverage.hpp"
+#include "banal/scheduler.hpp"
+#include "banal/worker.hpp"
 
 namespace banal {
 
 namespace {
 
+/// \brief Get the name of a function
+///
+/// \param binary The binary
+/// \param address Address of the function
+///
+/// \return Name of its symbol, or its address if it has none
+::std::string function_name(const binary::Binary& binary, uintarch_t address) {
+  if (address == 0) {
+    // above main
+    return "<runtime>";
+  }
+  if (auto symbol = binary.get_symbol(address); symbol) {
+    return ::std::string(symbol->name());
+  }
+  ::std::ostringstream name;
+  name << "0x" << ::std::hex << address;
+  return name.str();
+}
+
 [[maybe_unused]] static void dump_registers(::uc_engine* uc, Architecture a) {
   ::std::int32_t* regs = nullptr;
   ::std::uint64_t values[17];
@@ -114,95 +143,217 @@ namespace {
 
 Analysis::Analysis(const Options& opt, binary::Binary& binary)
     : _options(opt),
-      _csh(0),
-      _uc(nullptr),
+      _handles(binary.architecture()),
       _binary(binary),
       _virtual_binary_address(::std::nullopt),
+      _tracer(),
+      _writer(),
+      _engine(),
+      _main(),
+      _seed(),
+      _findings(),
       _good(false) {
-  {
-    auto capstone_value = get_cs_architecture(_binary.architecture());
-    if (auto e = ::cs_open(capstone_value.first, capstone_value.second, &_csh);
-        e != ::CS_ERR_OK) {
-      log::cerr() << "Unable to initialize Capstone engine: "
-                  << ::cs_strerror(e) << ::std::endl;
-      _good = false;
+  _seed.args.emplace_back(opt.filepath());
+  _seed.args.insert(_seed.args.end(), opt.argv().begin(), opt.argv().end());
+  if (!opt.input().empty()) {
+    ::std::ifstream in(opt.input(), ::std::ios::binary);
+    if (!in) {
+      log::cerr() << "Unable to open " << opt.input() << ::std::endl;
       return;
     }
-    log::cgood() << "Capstone loaded" << ::std::endl;
-    log::log("Capstone handler = ", _csh);
+    _seed.data.assign(::std::istreambuf_iterator< char >(in),
+                      ::std::istreambuf_iterator< char >());
   }
 
-  {
-    auto uc_value = get_uc_architecture(_binary.architecture());
-    if (auto e = ::uc_open(uc_value.first, uc_value.second, &_uc);
-        e != ::UC_ERR_OK) {
-      log::cerr() << "Unable to initialize Unicorn engine: " << ::uc_strerror(e)
-                  << ::std::endl;
-      _good = false;
-      return;
-    }
-    log::cgood() << "Unicorn engine loaded" << ::std::endl;
-    log::log("Unicorn engine handler = ", _uc);
+  if (!_handles.good()) {
+    return;
   }
+  log::cgood() << "Capstone loaded" << ::std::endl;
+  log::cgood() << "Unicorn engine loaded" << ::std::endl;
+  _good = true;
 }
 
 Analysis::~Analysis(void) {
-  if (auto e = ::cs_close(&_csh); e != ::CS_ERR_OK) {
-    log::cerr() << "Unable to close capstone engine: " << ::cs_strerror(e)
-                << ::std::endl;
+  // the engine uses the handlers, the tracer and the writer
+  _main.reset();
+  _engine.reset();
+  _writer.reset();
+  _tracer.reset();
+}
+
+bool Analysis::reset(void) {
+  if (!_engine) {
+    // debug
+    _binary.dump();
+
+    _engine = ::std::make_unique< execution::Engine >(
+        _handles.uc(), _handles.csh(), _binary, _options.instrumentation());
+    if (!_engine->good()) {
+      log::cerr() << "Unable to prepare the execution engine." << ::std::endl;
+      _engine.reset();
+      return false;
+    }
+    if (!_engine->watch(execution::checks(_options))) {
+      log::cerr() << "Unable to watch the stack." << ::std::endl;
+      _engine.reset();
+      return false;
+    }
+    if (_options.instrumentation() == Instrumentation::Instruction) {
+      _tracer = ::std::make_unique< execution::Tracer >(
+          _binary.architecture(), ::std::cerr);
+      if (!_engine->trace(*_tracer)) {
+        log::cerr() << "Unable to trace the execution." << ::std::endl;
+        _engine.reset();
+        return false;
+      }
+    }
+    if (!_options.trace_file().empty()) {
+      _writer =
+          ::std::make_unique< trace::Writer >(_options.trace_file(), _binary);
+      if (!_writer->good()) {
+        _writer.reset();
+        return false;
+      }
+      _engine->attach(*_writer);
+    }
+    if (_main = _engine->snapshot(); !_main) {
+      log::cwarn() << "Unable to take a snapshot at main, next runs will "
+                      "start from the end of this one."
+                   << ::std::endl;
+    }
+  } else if (_main && !_engine->restore(*_main)) {
+    log::cerr() << "Unable to restore the state at main." << ::std::endl;
+    return false;
+  }
+  return true;
+}
+
+void Analysis::report(::std::size_t index, const Finding& finding) const {
+  auto& out = log::cwarn() << "Finding #" << ::std::dec << index
+                           << " (iteration " << finding.iteration << "): ";
+  if (finding.reason == execution::Termination::Smash) {
+    out << "return address of " << function_name(_binary, finding.frame)
+        << " overwritten";
+  } else if (finding.reason == execution::Termination::Overflow) {
+    out << "write over the frame of " << function_name(_binary, finding.frame);
+  } else if (finding.reason == execution::Termination::Escape) {
+    out << function_name(_binary, finding.frame) << " wrote " << ::std::dec
+        << finding.size << " bytes past its frame into caller "
+        << function_name(_binary, finding.caller);
+  } else {
+    out << ::uc_strerror(finding.error);
   }
-  if (auto e = ::uc_close(_uc); e != ::UC_ERR_OK) {
-    log::cerr() << "Unable to close unicorn engine: " << ::uc_strerror(e)
-                << ::std::endl;
+  out << " at 0x" << ::std::hex << finding.pc << ", args:";
+  for (const auto& arg : finding.input.args) {
+    out << " \"" << arg << '"';
   }
-  _uc = nullptr;
+  out << ", stdin: " << ::std::dec << finding.input.data.size() << " bytes"
+      << ::std::endl;
 }
 
 void Analysis::start(::std::uint64_t entry) {
   (void)entry;
-  // debug
-  _binary.dump();
-
-  execution::Engine engine(_uc, _csh, _binary);
-
-  // set hooks
-  ::uc_cb_hookcode_t basic_block_hook = Analysis::hook_basic_block;
-  ::uc_hook hh;
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wc++98-compat-pedantic"
-  if (auto e = ::uc_hook_add(_uc,
-                             &hh,
-                             ::UC_HOOK_BLOCK,
-                             reinterpret_cast< void* >(basic_block_hook),
-                             static_cast< void* >(this),
-                             1,
-                             0);
-      e != ::UC_ERR_OK) {
-#pragma clang diagnostic pop
-    log::cerr() << "Unable to register hook: " << ::uc_strerror(e)
-                << ::std::endl;
+  if (!this->reset() || !_engine->prepare(_seed)) {
     return;
   }
 
-  // prepare capstone
-  if (!engine.emulate()) {
+  if (!_engine->emulate(_options.budget())) {
+    const auto& outcome = _engine->outcome();
+    if (outcome.reason == execution::Termination::Smash) {
+      log::cwarn() << "Return address of "
+                   << function_name(_binary, outcome.frame)
+                   << " overwritten: returned to 0x" << ::std::hex
+                   << outcome.code << " at 0x" << outcome.pc << ::std::endl;
+    } else if (outcome.reason == execution::Termination::Overflow) {
+      log::cwarn() << "Write over the frame of "
+                   << function_name(_binary, outcome.frame)
+                   << ": its return address or saved registers at 0x"
+                   << ::std::hex << outcome.code << " written at 0x"
+                   << outcome.pc << ::std::endl;
+    } else if (outcome.reason == execution::Termination::Escape) {
+      log::cwarn() << function_name(_binary, outcome.frame) << " wrote "
+                   << ::std::dec << outcome.code
+                   << " bytes past its frame into caller "
+                   << function_name(_binary, outcome.caller) << " at 0x"
+                   << ::std::hex << outcome.pc << ::std::endl;
+    } else {
+      log::cerr() << "Unable emulate code: " << ::uc_strerror(outcome.error)
+                  << " at 0x" << ::std::hex << outcome.pc << ::std::endl;
+    }
+  }
+  if (_writer) {
+    _writer->end(_engine->outcome());
   }
 }
 
-void Analysis::hook_basic_block(::uc_engine* uc,
-                                ::std::uint64_t address,
-                                ::std::uint32_t size,
-                                void* user_data) {
-  (void)uc;
-  (void)size;
-  (void)address;
-  Analysis* self = static_cast< Analysis* >(user_data);
-  return self->hook_basic_block(static_cast< uintarch_t >(address), size);
-}
+void Analysis::explore(::std::size_t iterations) {
+  if (_options.instrumentation() == Instrumentation::Instruction) {
+    log::cwarn() << "Exploring with instruction instrumentation is slow, "
+                    "consider -instrumentation=block."
+                 << ::std::endl;
+  }
+  auto jobs = _options.jobs();
+  if (jobs == 0) {
+    jobs = ::std::max(1U, ::std::thread::hardware_concurrency());
+  }
 
-void Analysis::hook_basic_block(uintarch_t address, ::std::uint32_t size) {
-  (void)size;
-  log::cinfo() << "Basic block detected on 0x" << ::std::hex << address
+  Coverage coverage;
+  ::std::vector<::std::unique_ptr< Worker > > workers;
+  for (::std::size_t i = 0; i < jobs; i++) {
+    workers.push_back(
+        ::std::make_unique< Worker >(_options, _binary, i, coverage));
+    if (!workers.back()->good()) {
+      log::cerr() << "Unable to prepare worker " << ::std::dec << i
+                  << ::std::endl;
+      return;
+    }
+  }
+  log::cgood() << ::std::dec << jobs << " worker(s) ready." << ::std::endl;
+
+  // the first run uses the input as is, next ones are spawned by runs
+  Scheduler scheduler(jobs, _options.priority(), iterations);
+  if (auto iteration = scheduler.reserve(); iteration) {
+    scheduler.push(0, Job{*iteration, 0, 0, 0, _seed});
+  }
+  ::std::vector<::std::thread > threads;
+  auto begin = ::std::chrono::steady_clock::now();
+  for (auto& w : workers) {
+    threads.emplace_back([&scheduler, &w] { w->run(scheduler); });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ::std::chrono::duration< double > elapsed =
+      ::std::chrono::steady_clock::now() - begin;
+
+  // merge the findings, keep the first input reaching each fault
+  ::std::size_t runs = 0;
+  for (const auto& w : workers) {
+    runs += w->runs();
+    for (const auto& f : w->findings()) {
+      auto it = ::std::find_if(
+          _findings.begin(), _findings.end(), [&f](const auto& g) {
+            return g.reason == f.reason && g.pc == f.pc &&
+                   g.error == f.error;
+          });
+      if (it == _findings.end()) {
+        _findings.push_back(f);
+      } else if (f.iteration < it->iteration) {
+        *it = f;
+      }
+    }
+  }
+  ::std::sort(_findings.begin(),
+              _findings.end(),
+              [](const auto& a, const auto& b) {
+                return a.iteration < b.iteration;
+              });
+  for (::std::size_t i = 0; i < _findings.size(); i++) {
+    this->report(i + 1, _findings[i]);
+  }
+  log::cgood() << ::std::dec << runs << " runs in " << elapsed.count()
+               << "s (" << static_cast< double >(runs) / elapsed.count()
+               << " runs/s), " << _findings.size() << " finding(s)."
                << ::std::endl;
 }
 
@@ -2,6 +2,7 @@
 #include <iostream>
 
 #include "banal/analysis.hpp"
+#include "banal/batch.hpp"
 #include "banal/binary/binary.hpp"
 #include "banal/options.hpp"
 
@@ -11,6 +12,11 @@ int main(int argc, char** argv) {
     return 1;
   }
 
+  if (!opt.batch().empty()) {
+    ::banal::Batch batch(opt);
+    return batch.good() && batch.run() ? 0 : 1;
+  }
+
   auto bin = ::banal::binary::open(opt);
   if (!bin) {
     return 1;
@@ -25,5 +31,12 @@ int main(int argc, char** argv) {
   ::banal::log::cinfo() << "Entry point: 0x" << ::std::hex << bin->entry()
                         << ::std::endl;
   ::banal::Analysis a(opt, *bin);
-  a.start();
+  if (!a.good()) {
+    return 1;
+  }
+  if (opt.iterations() > 0) {
+    a.explore(opt.iterations());
+  } else {
+    a.start();
+  }
 }
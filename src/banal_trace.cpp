@@ -0,0 +1,207 @@
+///
+/// \file
+/// \brief Trace decoder: prints a trace written by banal
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <llvm/Support/CommandLine.h>
+
+#include "banal/architecture.hpp"
+#include "banal/trace/reader.hpp"
+#include "banal/util/hash.hpp"
+#include "banal/util/log.hpp"
+
+namespace {
+
+/// \brief Options category
+::llvm::cl::OptionCategory TraceCategory("Trace Options");
+
+/// \brief The trace file
+::llvm::cl::opt<::std::string > TraceFile(::llvm::cl::Positional,
+                                          ::llvm::cl::desc("<trace file>"),
+                                          ::llvm::cl::Required,
+                                          ::llvm::cl::value_desc("filename"),
+                                          ::llvm::cl::cat(TraceCategory));
+
+/// \brief The traced binary, to check the hash
+::llvm::cl::opt<::std::string > BinaryFile(
+    "binary",
+    ::llvm::cl::desc("Check the trace against this binary"),
+    ::llvm::cl::value_desc("filename"),
+    ::llvm::cl::cat(TraceCategory));
+
+/// \brief Print a summary only
+::llvm::cl::opt< bool > Summary(
+    "summary",
+    ::llvm::cl::desc("Print counts and the hottest blocks, no disassembly"),
+    ::llvm::cl::cat(TraceCategory));
+
+/// \brief Number of hottest blocks in the summary
+constexpr ::std::size_t Hottest = 10;
+
+/// \brief Disassemble a block
+///
+/// \param csh Capstone handler
+/// \param block The block
+///
+/// \return The disassembly, one instruction per line
+::std::string disassemble(::csh csh, const ::banal::trace::BlockInfo& block) {
+  ::std::string text;
+  ::cs_insn* insn = nullptr;
+  auto count = ::cs_disasm(csh,
+                           block.bytes,
+                           static_cast<::std::size_t >(block.size),
+                           block.address,
+                           0,
+                           &insn);
+  char line[256];
+  for (::std::size_t i = 0; i < count; i++) {
+    auto n = ::std::snprintf(line,
+                             sizeof(line),
+                             "  0x%" PRIx64 ":\t%s\t%s\n",
+                             insn[i].address,
+                             insn[i].mnemonic,
+                             insn[i].op_str);
+    if (n > 0) {
+      text.append(
+          line, ::std::min(static_cast<::std::size_t >(n), sizeof(line) - 1));
+    }
+  }
+  if (count > 0) {
+    ::cs_free(insn, count);
+  }
+  return text;
+}
+
+/// \brief Check the hash of the traced binary
+///
+/// \param header Header of the trace
+///
+/// \return true if the binary matches, else false
+bool check(const ::banal::trace::Header& header) {
+  ::std::ifstream in(BinaryFile.getValue(), ::std::ios::binary);
+  if (!in) {
+    ::banal::log::cerr() << "Unable to open " << BinaryFile.getValue()
+                         << ::std::endl;
+    return false;
+  }
+  ::std::vector< char > data((::std::istreambuf_iterator< char >(in)),
+                             ::std::istreambuf_iterator< char >());
+  if (data.size() != header.size ||
+      ::banal::util::murmur64(data.data(), data.size()) != header.hash) {
+    ::banal::log::cwarn() << "The trace has not been taken on "
+                          << BinaryFile.getValue() << ::std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char** argv) {
+  ::llvm::cl::HideUnrelatedOptions(TraceCategory);
+  ::llvm::cl::ParseCommandLineOptions(argc,
+                                      argv,
+                                      "banal-trace -- print a banal trace");
+
+  ::banal::trace::Reader reader(TraceFile.getValue());
+  if (!reader.good()) {
+    return 1;
+  }
+  const auto& header = reader.header();
+  if (!BinaryFile.getValue().empty() && !check(header)) {
+    return 1;
+  }
+  if (header.architecture >
+      static_cast<::std::uint32_t >(::banal::Architecture::AArch64)) {
+    ::banal::log::cerr() << "Unknown architecture in trace." << ::std::endl;
+    return 1;
+  }
+  auto architecture = static_cast<::banal::Architecture >(header.architecture);
+  ::std::printf("binary hash %016" PRIx64 ", %" PRIu64 " bytes, %s\n",
+                header.hash,
+                header.size,
+                ::banal::get_architecture_long_name(architecture).data());
+
+  ::csh csh;
+  auto capstone_value = ::banal::get_cs_architecture(architecture);
+  if (auto e = ::cs_open(capstone_value.first, capstone_value.second, &csh);
+      e != ::CS_ERR_OK) {
+    ::banal::log::cerr() << "Unable to initialize Capstone engine: "
+                         << ::cs_strerror(e) << ::std::endl;
+    return 1;
+  }
+
+  // disassembly and execution count, by block id
+  ::std::vector<::std::string > texts;
+  ::std::vector<::std::uint64_t > counts;
+  ::std::uint64_t executed = 0;
+  ::std::uint64_t runs = 0;
+  ::banal::trace::Event event;
+  while (reader.next(event)) {
+    if (event.kind == ::banal::trace::Event::Kind::End) {
+      runs++;
+      ::std::printf("end of run %" PRIu64 " (reason %" PRIu64
+                    ", pc 0x%" PRIx64 ")\n",
+                    runs,
+                    event.reason,
+                    event.pc);
+      continue;
+    }
+    executed++;
+    if (counts.size() < reader.blocks()) {
+      counts.resize(reader.blocks(), 0);
+      texts.resize(reader.blocks());
+    }
+    counts[event.id]++;
+    if (Summary) {
+      continue;
+    }
+    const auto& block = reader.block(event.id);
+    auto& text = texts[event.id];
+    if (text.empty()) {
+      text = disassemble(csh, block);
+    }
+    ::std::printf("block #%" PRIu64 " 0x%" PRIx64 "\n%s",
+                  event.id,
+                  block.address,
+                  text.c_str());
+  }
+
+  ::std::printf("%" PRIu64 " blocks executed, %zu distinct, %" PRIu64
+                " run(s)\n",
+                executed,
+                reader.blocks(),
+                runs);
+  if (Summary) {
+    ::std::vector<::std::uint64_t > ids(counts.size());
+    for (::std::size_t i = 0; i < ids.size(); i++) {
+      ids[i] = i;
+    }
+    auto n = ::std::min(Hottest, ids.size());
+    ::std::partial_sort(ids.begin(),
+                        ids.begin() + static_cast< long >(n),
+                        ids.end(),
+                        [&counts](auto a, auto b) {
+                          return counts[a] > counts[b];
+                        });
+    for (::std::size_t i = 0; i < n; i++) {
+      ::std::printf("  0x%" PRIx64 ": %" PRIu64 "\n",
+                    reader.block(ids[i]).address,
+                    counts[ids[i]]);
+    }
+  }
+  ::cs_close(&csh);
+  return reader.good() ? 0 : 1;
+}
@@ -0,0 +1,632 @@
+///
+/// \file
+/// \brief Batch analysis implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <elfio/elf_types.hpp>
+
+#include "banal/batch.hpp"
+#include "banal/binary/binary.hpp"
+#include "banal/execution/engine.hpp"
+#include "banal/execution/map.hpp"
+#include "banal/summary.hpp"
+#include "banal/util/hash.hpp"
+#include "banal/util/log.hpp"
+
+namespace banal {
+
+namespace {
+
+/// \brief Number of entries of a new cache
+constexpr ::std::size_t CacheSlots = 1 << 18;
+
+/// \brief Version of the cached summaries, to bump when Summary or
+/// Summarizer change
+constexpr ::std::uint64_t SummaryVersion = 1;
+
+/// \brief Summary of a function of a binary, as cached
+struct Summarized {
+  /// \brief Normalized hash of the function
+  ::std::uint64_t hash;
+
+  /// \brief Index of the function in Binary::functions
+  ::std::uint64_t function;
+
+  /// \brief The summary
+  Summary summary;
+};
+
+/// \brief Hash what cached summaries depend on, besides the binary
+///
+/// \return The hash
+::std::uint64_t summary_salt(void) {
+  ::std::uint64_t params[] = {SummaryVersion,
+                              static_cast<::std::uint64_t >(ARCH_SIZE),
+                              sizeof(Summarized)};
+  return util::murmur64(params, sizeof(params));
+}
+
+/// \brief Compute the key of a function in the cache
+///
+/// \param hash Normalized hash of the function
+///
+/// \return The key, never 0
+::std::uint64_t function_key(::std::uint64_t hash) {
+  auto key = util::murmur64(&hash, sizeof(hash), summary_salt());
+  return key ? key : 1;
+}
+
+/// \brief Look the summaries of a binary up
+///
+/// \param cache The cache
+/// \param key Key of the binary
+///
+/// \return The summaries if cached, else nothing
+::std::optional<::std::vector< Summarized > > cached_summaries(
+    Cache& cache,
+    ::std::uint64_t key) {
+  auto data = cache.lookup(key, Artifact::Summary);
+  if (!data || data->size() % sizeof(Summarized) != 0) {
+    return ::std::nullopt;
+  }
+  ::std::vector< Summarized > records(data->size() / sizeof(Summarized));
+  ::std::memcpy(records.data(), data->data(), data->size());
+  return records;
+}
+
+/// \brief Quote a string for JSON
+///
+/// \param s The string
+///
+/// \return The quoted string
+::std::string quote(::std::string_view s) {
+  ::std::string q = "\"";
+  for (auto c : s) {
+    switch (c) {
+      case '"': {
+        q += "\\\"";
+      } break;
+      case '\\': {
+        q += "\\\\";
+      } break;
+      case '\n': {
+        q += "\\n";
+      } break;
+      case '\t': {
+        q += "\\t";
+      } break;
+      default: {
+        if (static_cast< unsigned char >(c) < 0x20) {
+          char escaped[8];
+          ::std::snprintf(escaped,
+                          sizeof(escaped),
+                          "\\u%04x",
+                          static_cast< unsigned >(c));
+          q += escaped;
+        } else {
+          q += c;
+        }
+      }
+    }
+  }
+  q += '"';
+  return q;
+}
+
+/// \brief Get the name of a termination
+///
+/// \param t The termination
+///
+/// \return The name
+::std::string_view termination_name(execution::Termination t) {
+  switch (t) {
+    case execution::Termination::Return:
+      return "return";
+    case execution::Termination::Exit:
+      return "exit";
+    case execution::Termination::Budget:
+      return "budget";
+    case execution::Termination::Fault:
+      return "fault";
+    case execution::Termination::Smash:
+      return "smash";
+    case execution::Termination::Overflow:
+      return "overflow";
+    case execution::Termination::Escape:
+      return "escape";
+  }
+  return "unknown";
+}
+
+/// \brief Hash what results depend on, besides the binary
+///
+/// \param opt Options from the command line
+/// \param seed Input given on the command line
+///
+/// \return The hash
+::std::uint64_t salt(const Options& opt, const execution::Input& seed) {
+  ::std::uint64_t params[] = {
+      static_cast<::std::uint64_t >(ARCH_SIZE),
+      static_cast<::std::uint64_t >(opt.budget()),
+      static_cast<::std::uint64_t >(opt.instrumentation()),
+      static_cast<::std::uint64_t >(opt.shadow()),
+      static_cast<::std::uint64_t >(opt.frames())};
+  auto h = util::murmur64(params, sizeof(params));
+  // records of another version may have other fields, or other results
+  h = util::murmur64(BANAL_VERSION, sizeof(BANAL_VERSION), h);
+  for (const auto& arg : seed.args) {
+    h = util::murmur64(arg.data(), arg.size() + 1, h);
+  }
+  return util::murmur64(seed.data.data(), seed.data.size(), h);
+}
+
+/// \brief Start the workers of a stage
+///
+/// Each worker pops from in and pushes what f returns to out, unless it is
+/// null. The last worker to end closes out.
+///
+/// \param threads Threads of the batch
+/// \param jobs Number of workers, at least 1
+/// \param in Input queue
+/// \param out Output queue
+/// \param f The work
+template < typename In, typename Out, typename F >
+void spawn(::std::vector<::std::thread >& threads,
+           ::std::size_t jobs,
+           util::Queue< In >& in,
+           util::Queue< Out >& out,
+           F f) {
+  jobs = ::std::max< ::std::size_t >(jobs, 1);
+  auto running = ::std::make_shared<::std::atomic<::std::size_t > >(jobs);
+  for (::std::size_t i = 0; i < jobs; i++) {
+    threads.emplace_back([&in, &out, running, f] {
+      for (In item; in.pop(item);) {
+        if (auto next = f(::std::move(item)); next) {
+          out.push(::std::move(next));
+        }
+      }
+      if (--*running == 0) {
+        out.close();
+      }
+    });
+  }
+}
+
+} // end anonymous namespace
+
+Batch::Batch(const Options& opt)
+    : _options(opt),
+      _paths(opt.batch_depth()),
+      _mapped(opt.batch_depth()),
+      _parsed(opt.batch_depth()),
+      _ready(opt.batch_depth()),
+      _seed(),
+      _file(),
+      _out(&::std::cout),
+      _mutex(),
+      _done(0),
+      _failed(0),
+      _cache(),
+      _salt(0),
+      _summaries_mutex(),
+      _summaries(),
+      _good(false) {
+  _seed.args.assign(opt.argv().begin(), opt.argv().end());
+  if (!opt.input().empty()) {
+    ::std::ifstream in(opt.input(), ::std::ios::binary);
+    if (!in) {
+      log::cerr() << "Unable to open " << opt.input() << ::std::endl;
+      return;
+    }
+    _seed.data.assign(::std::istreambuf_iterator< char >(in),
+                      ::std::istreambuf_iterator< char >());
+  }
+  if (opt.results() != "-") {
+    _file.open(opt.results());
+    if (!_file) {
+      log::cerr() << "Unable to open " << opt.results() << ::std::endl;
+      return;
+    }
+    _out = &_file;
+  }
+  if (!opt.cache().empty()) {
+    _cache = ::std::make_unique< Cache >(opt.cache(), CacheSlots);
+    if (!_cache->good()) {
+      return;
+    }
+    _salt = salt(opt, _seed);
+  }
+  _good = true;
+}
+
+bool Batch::run(void) {
+  auto jobs = _options.batch_jobs();
+  if (jobs == 0) {
+    jobs = ::std::max(1U, ::std::thread::hardware_concurrency());
+  }
+  auto begin = ::std::chrono::steady_clock::now();
+  ::std::vector<::std::thread > threads;
+  spawn(threads, _options.batch_io_jobs(), _paths, _mapped, [this](auto p) {
+    return this->map(::std::move(p));
+  });
+  spawn(threads,
+        _options.batch_parse_jobs(),
+        _mapped,
+        _parsed,
+        [this](auto item) { return this->parse(::std::move(item)); });
+  spawn(threads,
+        _options.batch_static_jobs(),
+        _parsed,
+        _ready,
+        [this](auto item) { return this->check(::std::move(item)); });
+  for (::std::size_t i = 0; i < jobs; i++) {
+    threads.emplace_back([this] { this->emulate(); });
+  }
+  auto produced = this->produce();
+  for (auto& t : threads) {
+    t.join();
+  }
+  ::std::chrono::duration< double > elapsed =
+      ::std::chrono::steady_clock::now() - begin;
+  _out->flush();
+  log::cgood() << ::std::dec << _done << " binaries in " << elapsed.count()
+               << "s, " << _failed << " could not be analyzed."
+               << ::std::endl;
+  return produced && _failed == 0;
+}
+
+bool Batch::produce(void) {
+  const auto& batch = _options.batch();
+  ::std::error_code e;
+  bool good = true;
+  if (batch != "-" && ::std::filesystem::is_directory(batch, e)) {
+    ::std::filesystem::recursive_directory_iterator it(
+        batch,
+        ::std::filesystem::directory_options::skip_permission_denied,
+        e);
+    for (; !e && it != ::std::filesystem::recursive_directory_iterator();
+         it.increment(e)) {
+      if (it->is_regular_file(e) && !_paths.push(it->path().string())) {
+        break;
+      }
+    }
+    if (e) {
+      log::cerr() << "Unable to walk " << batch << ": " << e.message()
+                  << ::std::endl;
+      good = false;
+    }
+  } else {
+    ::std::ifstream file;
+    if (batch != "-") {
+      file.open(batch);
+      if (!file) {
+        log::cerr() << "Unable to open " << batch << ::std::endl;
+        good = false;
+      }
+    }
+    auto& in = batch == "-" ? ::std::cin : file;
+    for (::std::string path; ::std::getline(in, path);) {
+      if (!path.empty() && !_paths.push(::std::move(path))) {
+        break;
+      }
+    }
+  }
+  _paths.close();
+  return good;
+}
+
+::std::unique_ptr< Batch::Item > Batch::map(::std::string path) {
+  auto item = ::std::make_unique< Item >();
+  item->begin = ::std::chrono::steady_clock::now();
+  item->path = ::std::move(path);
+  if (item->binary = binary::map(_options, item->path); !item->binary) {
+    this->fail(*item, "unable to map");
+    return nullptr;
+  }
+  return item;
+}
+
+::std::unique_ptr< Batch::Item > Batch::parse(::std::unique_ptr< Item > item) {
+  if (!binary::parse(*item->binary)) {
+    this->fail(*item, "unsupported binary");
+    return nullptr;
+  }
+  if (_cache) {
+    item->key = Cache::key(*item->binary, _salt);
+    if (auto fields = _cache->lookup(item->key, Artifact::Result);
+        fields && !fields->empty()) {
+      // the first byte tells if the binary had been analyzed
+      this->seed(*item->binary);
+      this->write(*item,
+                  ::std::string_view(*fields).substr(1),
+                  (*fields)[0] == '+',
+                  true);
+      return nullptr;
+    }
+  }
+  item->fields = ",\"architecture\":" +
+                 quote(get_architecture_short_name(
+                     item->binary->architecture())) +
+                 ",\"entry\":" + ::std::to_string(item->binary->entry());
+  return item;
+}
+
+::std::unique_ptr< Batch::Item > Batch::check(::std::unique_ptr< Item > item) {
+  auto& bin = *item->binary;
+  // the engine starts at main, drop binaries without it before emulation
+  auto main = bin.find_symbol("main");
+  if (!main || !bin.get_address(*main)) {
+    this->fail(*item, "no main");
+    return nullptr;
+  }
+  // build the address index, observers look symbols up by address
+  (void)bin.get_symbol(main->value());
+
+  // fault the loaded pages in now, rather than in the emulation stage
+  ::std::uint8_t sum = 0;
+  for (auto it = bin.segments_cbegin(); it != bin.segments_cend(); it++) {
+    const auto& seg = *it;
+    if (seg->type() != PT_LOAD || seg->data() == nullptr) {
+      continue;
+    }
+    const volatile ::std::uint8_t* data = seg->data();
+    for (::std::size_t off = 0; off < seg->file_size();
+         off += execution::PageSize) {
+      sum = static_cast<::std::uint8_t >(sum + data[off]);
+    }
+  }
+  (void)sum;
+
+  this->summarize(*item);
+  return item;
+}
+
+void Batch::summarize(Item& item) {
+  const auto& bin = *item.binary;
+  auto functions = bin.functions();
+  // records are value initialized, padding included, since they are cached
+  // as raw bytes
+  ::std::vector< Summarized > records;
+  ::std::uint64_t key = 0;
+  bool cached = false;
+  if (_cache) {
+    key = Cache::key(bin, summary_salt());
+    if (auto cached_records = cached_summaries(*_cache, key); cached_records) {
+      records = ::std::move(*cached_records);
+      cached = true;
+    }
+  }
+
+  ::std::size_t reused = 0;
+  if (cached) {
+    reused = records.size();
+    ::std::lock_guard< ::std::mutex > lock(_summaries_mutex);
+    for (const auto& record : records) {
+      _summaries.emplace(record.hash, record.summary);
+    }
+  } else {
+    Summarizer summarizer(bin);
+    if (!summarizer.good()) {
+      return;
+    }
+    for (::std::size_t i = 0; i < functions.size(); i++) {
+      if (auto hash = summarizer.hash(functions[i]); hash) {
+        auto& record = records.emplace_back();
+        record.hash = *hash;
+        record.function = i;
+      }
+    }
+    // copies of a function share their summary, whatever the binary
+    ::std::vector< bool > known(records.size(), false);
+    {
+      ::std::lock_guard< ::std::mutex > lock(_summaries_mutex);
+      for (::std::size_t i = 0; i < records.size(); i++) {
+        if (auto it = _summaries.find(records[i].hash);
+            it != _summaries.end()) {
+          records[i].summary = it->second;
+          known[i] = true;
+          reused++;
+        }
+      }
+    }
+    for (::std::size_t i = 0; i < records.size(); i++) {
+      if (known[i] || !_cache) {
+        continue;
+      }
+      // summarized in another binary, by a previous batch
+      if (auto data =
+              _cache->lookup(function_key(records[i].hash), Artifact::Function);
+          data && data->size() == sizeof(Summary)) {
+        ::std::memcpy(&records[i].summary, data->data(), sizeof(Summary));
+        known[i] = true;
+        reused++;
+      }
+    }
+    for (::std::size_t i = 0; i < records.size(); i++) {
+      if (known[i]) {
+        continue;
+      }
+      if (auto summary = summarizer.summarize(functions[records[i].function]);
+          summary) {
+        records[i].summary = *summary;
+        if (_cache) {
+          _cache->store(function_key(records[i].hash),
+                        Artifact::Function,
+                        ::std::string_view(reinterpret_cast< const char* >(
+                                               &records[i].summary),
+                                           sizeof(Summary)));
+        }
+      } else {
+        // hashes are never 0
+        records[i].hash = 0;
+      }
+    }
+    records.erase(::std::remove_if(records.begin(),
+                                   records.end(),
+                                   [](const auto& r) { return r.hash == 0; }),
+                  records.end());
+    {
+      ::std::lock_guard< ::std::mutex > lock(_summaries_mutex);
+      for (const auto& record : records) {
+        _summaries.emplace(record.hash, record.summary);
+      }
+    }
+    if (_cache) {
+      _cache->store(key,
+                    Artifact::Summary,
+                    ::std::string_view(
+                        reinterpret_cast< const char* >(records.data()),
+                        records.size() * sizeof(Summarized)));
+    }
+  }
+
+  ::std::string flagged;
+  for (const auto& record : records) {
+    if (record.function < functions.size() &&
+        (record.summary.verdict &
+         (Verdict::Indexed | Verdict::Dangerous | Verdict::Escapes))) {
+      flagged += flagged.empty() ? "" : ",";
+      flagged += quote(functions[record.function].name());
+    }
+  }
+  item.fields += ",\"functions\":" + ::std::to_string(records.size()) +
+                 ",\"reused\":" + ::std::to_string(reused) +
+                 ",\"flagged\":[" + flagged + "]";
+}
+
+void Batch::seed(const binary::Binary& binary) {
+  auto records = cached_summaries(*_cache, Cache::key(binary, summary_salt()));
+  if (!records) {
+    return;
+  }
+  ::std::lock_guard< ::std::mutex > lock(_summaries_mutex);
+  for (const auto& record : *records) {
+    _summaries.emplace(record.hash, record.summary);
+  }
+}
+
+void Batch::emulate(void) {
+  // handlers are not thread safe, each worker owns its own
+  ::std::map< Architecture, execution::Handles > handles;
+  for (::std::unique_ptr< Item > item; _ready.pop(item);) {
+    this->emulate(*item, handles);
+  }
+}
+
+void Batch::emulate(Item& item,
+                    ::std::map< Architecture, execution::Handles >& handles) {
+  auto& bin = *item.binary;
+  auto architecture = bin.architecture();
+  auto it = handles.find(architecture);
+  if (it == handles.end()) {
+    it = handles.emplace(architecture, execution::Handles(architecture)).first;
+  }
+  if (!it->second.good()) {
+    // it does not depend on the binary, do not cache it
+    item.key = 0;
+    this->fail(item, "no handlers");
+    return;
+  }
+
+  // the engine unmaps its memory and drops its hooks when destroyed, the
+  // handlers are then ready for the next binary
+  execution::Engine engine(
+      it->second.uc(), it->second.csh(), bin, _options.instrumentation());
+  if (!engine.good()) {
+    this->fail(item, "unable to load");
+    return;
+  }
+  if (!engine.watch(execution::checks(_options))) {
+    this->fail(item, "unable to watch the stack");
+    return;
+  }
+  auto input = _seed;
+  input.args.insert(input.args.begin(), item.path);
+  if (!engine.prepare(input)) {
+    this->fail(item, "unable to prepare");
+    return;
+  }
+  engine.emulate(_options.budget());
+
+  const auto& outcome = engine.outcome();
+  ::std::ostringstream record;
+  record << ",\"status\":\"ok\",\"termination\":"
+         << quote(termination_name(outcome.reason));
+  if (outcome.reason == execution::Termination::Fault) {
+    record << ",\"error\":" << quote(::uc_strerror(outcome.error))
+           << ",\"pc\":" << ::std::dec << outcome.pc;
+  } else if (outcome.reason == execution::Termination::Smash ||
+             outcome.reason == execution::Termination::Overflow) {
+    record << ",\"pc\":" << ::std::dec << outcome.pc
+           << (outcome.reason == execution::Termination::Smash
+                   ? ",\"target\":"
+                   : ",\"address\":")
+           << outcome.code;
+    if (auto symbol = bin.get_symbol(outcome.frame); symbol) {
+      record << ",\"function\":" << quote(symbol->name());
+    }
+  } else if (outcome.reason == execution::Termination::Escape) {
+    record << ",\"pc\":" << ::std::dec << outcome.pc
+           << ",\"bytes\":" << outcome.code;
+    if (auto symbol = bin.get_symbol(outcome.frame); symbol) {
+      record << ",\"function\":" << quote(symbol->name());
+    }
+    if (auto symbol = bin.get_symbol(outcome.caller); symbol) {
+      record << ",\"caller\":" << quote(symbol->name());
+    }
+  } else {
+    record << ",\"code\":" << ::std::dec << outcome.code;
+  }
+  item.fields += record.str();
+  this->finish(item, true);
+}
+
+void Batch::fail(Item& item, ::std::string_view error) {
+  item.fields += ",\"status\":\"error\",\"error\":";
+  item.fields += quote(error);
+  this->finish(item, false);
+}
+
+void Batch::finish(const Item& item, bool ok) {
+  if (_cache && item.key != 0) {
+    _cache->store(
+        item.key, Artifact::Result, (ok ? "+" : "-") + item.fields);
+  }
+  this->write(item, item.fields, ok, false);
+}
+
+void Batch::write(const Item& item,
+                  ::std::string_view fields,
+                  bool ok,
+                  bool cached) {
+  ::std::chrono::duration< double > elapsed =
+      ::std::chrono::steady_clock::now() - item.begin;
+  ::std::lock_guard< ::std::mutex > lock(_mutex);
+  *_out << "{\"path\":" << quote(item.path) << fields
+        << ",\"time\":" << elapsed.count()
+        << (cached ? ",\"cached\":true}" : "}") << '\n';
+  _done++;
+  if (!ok) {
+    _failed++;
+  }
+}
+
+} // end namespace banal
@@ -40,15 +40,15 @@ Binary::Binary(const Options& opt, int fd, void* addr, ::std::size_t file_len)
     : _begin(reinterpret_cast<::std::uint8_t* >(addr)),
       _end(reinterpret_cast<::std::uint8_t* >(addr) + file_len),
       _fd(fd),
-      _stream(reinterpret_cast<::std::uint8_t* >(addr), file_len),
       _opt(opt),
       _good(false) {}
 
-::std::unique_ptr< Binary > open(const ::banal::Options& opt) {
-  auto fd = ::open(opt.filepath().data(), O_RDONLY);
+::std::unique_ptr< Binary > map(const ::banal::Options& opt,
+                                const ::std::string& path) {
+  auto fd = ::open(path.c_str(), O_RDONLY);
   if (fd == -1) {
     // Cannot open file. Abort.
-    log::cerr() << "Unable to open " << opt.filepath() << ": "
+    log::cerr() << "Unable to open " << path << ": "
                 << ::std::strerror(errno) << ::std::endl;
     return nullptr;
   }
@@ -56,14 +56,14 @@ Binary::Binary(const Options& opt, int fd, void* addr, ::std::size_t file_len)
   struct stat file_stat;
   if (fstat(fd, &file_stat) != 0) {
     // Cannnot get stats about file. Abort.
-    log::cerr() << "Cannot exec fstat on " << opt.filepath() << ::std::endl;
+    log::cerr() << "Cannot exec fstat on " << path << ::std::endl;
     safe_close(fd);
     return nullptr;
   }
 
   if (S_ISREG(file_stat.st_mode) == 0) {
     // Not a regular file. Abort.
-    log::cerr() << "" << opt.filepath() << " is not a regular file."
+    log::cerr() << "" << path << " is not a regular file."
                 << ::std::endl;
     safe_close(fd);
     return nullptr;
@@ -79,18 +79,21 @@ Binary::Binary(const Options& opt, int fd, void* addr, ::std::size_t file_len)
                       MAP_PRIVATE,
                       fd,
                       0);
-  if (addr == nullptr) {
-    log::cerr() << "Unable to map file " << opt.filepath() << ": "
+  if (addr == MAP_FAILED) {
+    log::cerr() << "Unable to map file " << path << ": "
                 << ::std::strerror(errno) << ::std::endl;
     safe_close(fd);
     return nullptr;
   }
+  // only a hint, the parsing faults the pages in anyway
+  ::madvise(
+      addr, static_cast<::std::size_t >(file_stat.st_size), MADV_WILLNEED);
 
   const uint8_t* baddr = static_cast< const uint8_t* >(addr);
   ::std::unique_ptr< binary::Binary > bin;
   // Read magic
-  if (baddr[0] == '\x7f' && baddr[1] == 'E' && baddr[2] == 'L' &&
-      baddr[3] == 'F') {
+  if (file_stat.st_size >= 4 && baddr[0] == '\x7f' && baddr[1] == 'E' &&
+      baddr[2] == 'L' && baddr[3] == 'F') {
     // elf
     bin = ::std::make_unique< binary::ELFBinary >(opt,
                                                   fd,
@@ -100,16 +103,34 @@ Binary::Binary(const Options& opt, int fd, void* addr, ::std::size_t file_len)
   } else {
     // nothing
     log::cerr() << "This file format is not supported yet." << ::std::endl;
+    ::munmap(addr, static_cast<::std::size_t >(file_stat.st_size));
+    safe_close(fd);
     return nullptr;
   }
-  if (bin->parse()) {
+  return bin;
+}
+
+bool parse(Binary& binary) {
+  return binary.parse();
+}
+
+::std::unique_ptr< Binary > open(const ::banal::Options& opt,
+                                 const ::std::string& path) {
+  auto bin = map(opt, path);
+  if (bin && parse(*bin)) {
     return bin;
   } else {
     return nullptr;
   }
 }
 
+::std::unique_ptr< Binary > open(const ::banal::Options& opt) {
+  return open(opt, ::std::string(opt.filepath()));
+}
+
 Binary::~Binary(void) {
+  // sections, segments and symbols point into the mapping
+  ::munmap(_begin, this->size());
   safe_close(_fd);
 }
 
@@ -6,24 +6,60 @@
 ///
 /// Contact: thomas at bailleux.me
 
+#include <memory>
+
 #include "banal/binary/component/symbol.hpp"
 
 namespace banal {
 namespace binary {
 namespace component {
 
-Symbol::Symbol(::std::size_t index,
-               ::std::string_view name,
-               uintarch_t value,
-               ::std::size_t size,
-               ::std::uint8_t type,
-               Section& section)
-    : _index(index),
-      _name(name),
-      _value(value),
-      _size(size),
-      _type(type),
-      _section(section) {}
+namespace {
+
+/// \brief Round a size up to a number of arena words
+///
+/// \param size The size, in bytes
+///
+/// \return The number of words
+constexpr ::std::size_t words(::std::size_t size) {
+  return (size + sizeof(::std::uint64_t) - 1) / sizeof(::std::uint64_t);
+}
+
+} // end anonymous namespace
+
+SymbolTable::SymbolTable(void)
+    : _arena(),
+      _size(0),
+      _capacity(0),
+      _names(nullptr),
+      _values(nullptr),
+      _sizes(nullptr),
+      _sections(nullptr),
+      _types(nullptr) {}
+
+void SymbolTable::reserve(::std::size_t capacity) {
+  // arrays are laid out by decreasing alignment, each one on a word
+  auto names = words(capacity * sizeof(::std::string_view));
+  auto values = words(capacity * sizeof(uintarch_t));
+  auto sizes = words(capacity * sizeof(::std::size_t));
+  auto sections = words(capacity * sizeof(::std::uint16_t));
+  auto types = words(capacity * sizeof(::std::uint8_t));
+  _arena = ::std::make_unique<::std::uint64_t[] >(names + values + sizes +
+                                                  sections + types);
+  auto* p = _arena.get();
+  _names = reinterpret_cast<::std::string_view* >(p);
+  ::std::uninitialized_default_construct_n(_names, capacity);
+  p += names;
+  _values = reinterpret_cast< uintarch_t* >(p);
+  p += values;
+  _sizes = reinterpret_cast<::std::size_t* >(p);
+  p += sizes;
+  _sections = reinterpret_cast<::std::uint16_t* >(p);
+  p += sections;
+  _types = reinterpret_cast<::std::uint8_t* >(p);
+  _size = 0;
+  _capacity = capacity;
+}
 
 } // end namespace component
 } // end namespace binary
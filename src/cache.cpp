@@ -0,0 +1,246 @@
+///
+/// \file
+/// \brief Persistent analysis cache implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "banal/cache.hpp"
+#include "banal/util/hash.hpp"
+#include "banal/util/log.hpp"
+
+namespace banal {
+
+namespace {
+
+/// \brief Magic number of a cache file
+constexpr char Magic[8] = {'b', 'a', 'n', 'a', 'l', 'c', 'c', 'h'};
+
+/// \brief Version of the layout
+constexpr ::std::uint32_t Version = 1;
+
+/// \brief Offset of the table in the file
+constexpr ::std::size_t TableOffset = 64;
+
+} // end anonymous namespace
+
+struct Cache::Header {
+  /// \brief Magic number
+  char magic[8];
+
+  /// \brief Version of the layout
+  ::std::uint32_t version;
+
+  /// \brief Padding
+  ::std::uint32_t reserved;
+
+  /// \brief Number of entries, a power of 2
+  ::std::uint64_t slots;
+
+  /// \brief Number of used entries
+  ::std::uint64_t used;
+
+  /// \brief End of the artifacts in the file
+  ::std::uint64_t end;
+};
+
+struct Cache::Entry {
+  /// \brief Key of the binary, 0 if the entry is empty
+  ::std::uint64_t key;
+
+  /// \brief Offset of the artifact in the file
+  ::std::uint64_t offset;
+
+  /// \brief Kind of the artifact
+  ::std::uint32_t kind;
+
+  /// \brief Size of the artifact
+  ::std::uint32_t size;
+};
+
+Cache::Cache(const ::std::string& path, ::std::size_t slots)
+    : _path(path),
+      _fd(-1),
+      _header(nullptr),
+      _mapped(0),
+      _mutex(),
+      _good(false) {
+  _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (_fd == -1) {
+    log::cerr() << "Unable to open the cache " << path << ": "
+                << ::std::strerror(errno) << ::std::endl;
+    return;
+  }
+  // another process may be creating it
+  if (!this->lock(F_WRLCK)) {
+    return;
+  }
+  struct stat st;
+  bool ok = ::fstat(_fd, &st) == 0 && (st.st_size > 0 || this->create(slots));
+  Header header;
+  ok = ok && ::pread(_fd, &header, sizeof(header), 0) ==
+                 static_cast<::ssize_t >(sizeof(header));
+  ok = ok && ::fstat(_fd, &st) == 0;
+  this->lock(F_UNLCK);
+  if (!ok || ::std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+      header.version != Version || header.slots == 0 ||
+      (header.slots & (header.slots - 1)) != 0 ||
+      header.end < TableOffset + header.slots * sizeof(Entry) ||
+      static_cast<::std::uint64_t >(st.st_size) < header.end) {
+    log::cerr() << "The cache " << path << " is not a valid cache."
+                << ::std::endl;
+    return;
+  }
+
+  // only the header and the table are mapped, artifacts are read with pread
+  _mapped = TableOffset + static_cast<::std::size_t >(header.slots) *
+                              sizeof(Entry);
+  void* addr =
+      ::mmap(nullptr, _mapped, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+  if (addr == MAP_FAILED) {
+    log::cerr() << "Unable to map the cache " << path << ": "
+                << ::std::strerror(errno) << ::std::endl;
+    return;
+  }
+  _header = static_cast< Header* >(addr);
+  _good = true;
+}
+
+Cache::~Cache(void) {
+  if (_header) {
+    ::munmap(_header, _mapped);
+  }
+  if (_fd != -1) {
+    ::close(_fd);
+  }
+}
+
+bool Cache::lock(short type) {
+  struct flock fl = {};
+  fl.l_type = type;
+  fl.l_whence = SEEK_SET;
+  fl.l_start = 0;
+  fl.l_len = 0;
+  while (::fcntl(_fd, F_SETLKW, &fl) == -1) {
+    if (errno != EINTR) {
+      log::cerr() << "Unable to lock the cache " << _path << ": "
+                  << ::std::strerror(errno) << ::std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Cache::create(::std::size_t slots) {
+  static_assert(sizeof(Header) <= TableOffset, "The header is too large");
+  ::std::uint64_t n = 1;
+  while (n < slots) {
+    n <<= 1;
+  }
+  Header header = {};
+  ::std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.slots = n;
+  header.used = 0;
+  header.end = TableOffset + n * sizeof(Entry);
+  // the table is a hole until entries are written
+  return ::ftruncate(_fd, static_cast<::off_t >(header.end)) == 0 &&
+         ::pwrite(_fd, &header, sizeof(header), 0) ==
+             static_cast<::ssize_t >(sizeof(header));
+}
+
+::std::uint64_t Cache::key(const binary::Binary& binary,
+                           ::std::uint64_t salt) {
+  ::std::uint64_t key;
+  if (auto id = binary.build_id(); !id.empty()) {
+    key = util::murmur64(id.data(), id.size(), salt);
+  } else {
+    key = util::murmur64(binary.begin(), binary.size(), ~salt);
+  }
+  return key ? key : 1;
+}
+
+Cache::Entry* Cache::find(::std::uint64_t key, Artifact kind) {
+  auto* table = reinterpret_cast< Entry* >(
+      reinterpret_cast<::std::uint8_t* >(_header) + TableOffset);
+  auto mask = _header->slots - 1;
+  auto k = static_cast<::std::uint32_t >(kind);
+  for (::std::uint64_t i = 0, slot = key & mask; i <= mask;
+       i++, slot = (slot + 1) & mask) {
+    auto& entry = table[slot];
+    if (entry.key == 0 || (entry.key == key && entry.kind == k)) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+::std::optional<::std::string > Cache::lookup(::std::uint64_t key,
+                                              Artifact kind) {
+  ::std::lock_guard< ::std::mutex > guard(_mutex);
+  if (!this->lock(F_RDLCK)) {
+    return ::std::nullopt;
+  }
+  ::std::optional<::std::string > data;
+  const auto* entry = this->find(key, kind);
+  if (entry != nullptr && entry->key != 0 &&
+      entry->offset + entry->size <= _header->end) {
+    ::std::string s(entry->size, '\0');
+    auto offset = static_cast<::off_t >(entry->offset);
+    if (::pread(_fd, s.data(), s.size(), offset) ==
+        static_cast<::ssize_t >(s.size())) {
+      data = ::std::move(s);
+    }
+  }
+  this->lock(F_UNLCK);
+  return data;
+}
+
+bool Cache::store(::std::uint64_t key,
+                  Artifact kind,
+                  ::std::string_view data) {
+  if (data.size() > UINT32_MAX) {
+    return false;
+  }
+  ::std::lock_guard< ::std::mutex > guard(_mutex);
+  if (!this->lock(F_WRLCK)) {
+    return false;
+  }
+  bool ok = false;
+  auto* entry = this->find(key, kind);
+  if (entry == nullptr ||
+      (entry->key == 0 && (_header->used + 1) * 4 > _header->slots * 3)) {
+    log::cwarn() << "The cache " << _path << " is full." << ::std::endl;
+  } else if (::pwrite(_fd,
+                      data.data(),
+                      data.size(),
+                      static_cast<::off_t >(_header->end)) ==
+             static_cast<::ssize_t >(data.size())) {
+    // the artifact is written before the entry points to it, the key last
+    if (entry->key == 0) {
+      _header->used++;
+    }
+    entry->offset = _header->end;
+    entry->size = static_cast<::std::uint32_t >(data.size());
+    entry->kind = static_cast<::std::uint32_t >(kind);
+    entry->key = key;
+    _header->end += data.size();
+    ok = true;
+  } else {
+    log::cerr() << "Unable to write to the cache " << _path << ": "
+                << ::std::strerror(errno) << ::std::endl;
+  }
+  this->lock(F_UNLCK);
+  return ok;
+}
+
+} // end namespace banal
@@ -6,6 +6,13 @@
 ///
 /// Contact: thomas at bailleux.me
 
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+
 #include <elfio/elf_types.hpp>
 
 #include "banal/architecture.hpp"
@@ -14,12 +21,255 @@
 namespace banal {
 namespace execution {
 
-bool Engine::load_segment(::banal::binary::component::Segment& seg) {
-  // Compute the size of the page
-  ::std::size_t size = seg.memory_size();
-  if ((size % 4096) > 0) {
-    size = (1 + (size / 4096)) * 4096;
+namespace {
+
+/// \brief Size reserved for the stack, materialized on demand
+constexpr ::std::size_t StackSize = 8 * 1024 * 1024;
+
+/// \brief Maximum size of the initial stack: arguments, environment and
+/// auxiliary vector
+constexpr ::std::size_t ImageSize = 32 * PageSize;
+
+/// \brief Top of the stack, which ends with the page at banal::stack()
+///
+/// \return Address right after the stack
+inline uintarch_t stack_top(void) {
+  return ::banal::stack() + static_cast< uintarch_t >(PageSize);
+}
+
+/// \brief Lowest address of the stack
+///
+/// \return Address of the stack
+inline uintarch_t stack_address(void) {
+  return stack_top() - static_cast< uintarch_t >(StackSize);
+}
+
+/// \brief Address of the guard page, right below the stack
+///
+/// \return Address of the guard page
+inline uintarch_t guard_address(void) {
+  return stack_address() - static_cast< uintarch_t >(PageSize);
+}
+
+/// \brief Address main returns to, the emulation stops there
+///
+/// \return Address of the exit page
+inline uintarch_t exit_address(void) {
+  return guard_address() - static_cast< uintarch_t >(PageSize);
+}
+
+/// \brief Types of the entries of the auxiliary vector
+struct Aux {
+  enum : uintarch_t {
+    Null = 0,      ///< End of the vector
+    Phdr = 3,      ///< Address of the program headers
+    Phent = 4,     ///< Size of a program header
+    Phnum = 5,     ///< Number of program headers
+    Pagesz = 6,    ///< Size of a page
+    Flags = 8,     ///< Flags
+    Entry = 9,     ///< Entry point of the program
+    Uid = 11,      ///< Real user id
+    Euid = 12,     ///< Effective user id
+    Gid = 13,      ///< Real group id
+    Egid = 14,     ///< Effective group id
+    Platform = 15, ///< Address of the platform string
+    Clktck = 17,   ///< Frequency of times()
+    Secure = 23,   ///< Secure mode
+    Random = 25,   ///< Address of 16 random bytes
+    Execfn = 31,   ///< Address of the file name of the program
+  };
+};
+
+/// \brief Bytes pointed by AT_RANDOM, fixed so that runs are reproducible
+constexpr ::std::uint8_t Random[16] = {0x62, 0x61, 0x6e, 0x61, 0x6c, 0x2d,
+                                       0x72, 0x61, 0x6e, 0x64, 0x6f, 0x6d,
+                                       0x2d, 0x31, 0x36, 0x00};
+
+/// \brief Platform string pointed by AT_PLATFORM
+#if ARCH_SIZE == ARCH_SIZE_64
+constexpr char Platform[] = "x86_64";
+#else
+constexpr char Platform[] = "i686";
+#endif
+
+/// \brief Size of a stack slot
+constexpr uintarch_t WordSize = sizeof(uintarch_t);
+
+/// \brief Interrupt used for system calls on x86
+constexpr ::std::uint32_t SyscallInterrupt = 0x80;
+
+/// \brief Error numbers returned by system calls
+struct Errno {
+  enum : uintarch_t {
+    Fault = 14, ///< Bad address
+    NoSys = 38, ///< Function not implemented
+  };
+};
+
+#if ARCH_SIZE == ARCH_SIZE_64
+/// \brief Supported system calls (x86_64)
+struct Syscall {
+  enum : uintarch_t { Read = 0, Write = 1, Exit = 60, ExitGroup = 231 };
+};
+
+/// \brief System call number and arguments registers, the first one also
+/// holds the result
+constexpr int SyscallRegs[] = {
+    ::UC_X86_REG_RAX, ::UC_X86_REG_RDI, ::UC_X86_REG_RSI, ::UC_X86_REG_RDX};
+
+/// \brief Callee-saved registers (capstone registers)
+constexpr ::x86_reg CalleeSaved[] = {::X86_REG_RBX,
+                                     ::X86_REG_RBP,
+                                     ::X86_REG_R12,
+                                     ::X86_REG_R13,
+                                     ::X86_REG_R14,
+                                     ::X86_REG_R15};
+#else
+/// \brief Supported system calls (x86)
+struct Syscall {
+  enum : uintarch_t { Read = 3, Write = 4, Exit = 1, ExitGroup = 252 };
+};
+
+/// \brief System call number and arguments registers, the first one also
+/// holds the result
+constexpr int SyscallRegs[] = {
+    ::UC_X86_REG_EAX, ::UC_X86_REG_EBX, ::UC_X86_REG_ECX, ::UC_X86_REG_EDX};
+
+/// \brief Callee-saved registers (capstone registers)
+constexpr ::x86_reg CalleeSaved[] = {
+    ::X86_REG_EBX, ::X86_REG_EBP, ::X86_REG_ESI, ::X86_REG_EDI};
+#endif
+
+/// \brief Compute the flags of an instruction
+///
+/// \param csh Capstone handler
+/// \param insn The instruction, with details
+/// \param sp Capstone stack pointer register
+///
+/// \return The flags (see InsnFlags) and the stack pointer delta
+::std::pair<::std::uint8_t, ::std::int32_t > classify(::csh csh,
+                                                      const ::cs_insn& insn,
+                                                      ::std::uint32_t sp) {
+  ::std::uint8_t flags = InsnFlags::None;
+  ::std::int32_t delta = 0;
+  if (::cs_insn_group(csh, &insn, ::CS_GRP_CALL)) {
+    flags |= InsnFlags::Call | InsnFlags::Store;
+  }
+  if (::cs_insn_group(csh, &insn, ::CS_GRP_RET)) {
+    flags |= InsnFlags::Ret;
+  }
+  if (::cs_insn_group(csh, &insn, ::CS_GRP_JUMP)) {
+    flags |= InsnFlags::Jump;
+  }
+  const auto& x86 = insn.detail->x86;
+  for (::std::uint8_t i = 0; i < x86.op_count; i++) {
+    const auto& op = x86.operands[i];
+    if (op.type == ::X86_OP_MEM && (op.access & ::CS_AC_WRITE)) {
+      flags |= InsnFlags::Store;
+    }
+  }
+  switch (insn.id) {
+    case ::X86_INS_PUSH: {
+      flags |= InsnFlags::Store;
+      const auto& src = x86.operands[0];
+      if (x86.op_count == 1 && src.type == ::X86_OP_REG &&
+          ::std::find(::std::begin(CalleeSaved),
+                      ::std::end(CalleeSaved),
+                      src.reg) != ::std::end(CalleeSaved)) {
+        flags |= InsnFlags::Save;
+      }
+    } break;
+    case ::X86_INS_SUB:
+    case ::X86_INS_ADD: {
+      const auto& dst = x86.operands[0];
+      const auto& src = x86.operands[1];
+      if (x86.op_count == 2 && dst.type == ::X86_OP_REG && dst.reg == sp &&
+          src.type == ::X86_OP_IMM) {
+        flags |= InsnFlags::StackAdjust;
+        delta = static_cast<::std::int32_t >(src.imm);
+        if (insn.id == ::X86_INS_SUB) {
+          delta = -delta;
+        }
+      }
+    } break;
+  }
+  return {flags, delta};
+}
+
+/// \brief Reserve zeroed host memory, pages are allocated when touched
+///
+/// \param size Size of the memory
+///
+/// \return The memory, or nullptr if an error has occured
+::std::uint8_t* reserve(::std::size_t size) {
+  void* addr = ::mmap(nullptr,
+                      size,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                      -1,
+                      0);
+  return addr == MAP_FAILED ? nullptr : static_cast<::std::uint8_t* >(addr);
+}
+
+/// \brief Get the pages of a segment
+///
+/// \param seg The segment
+///
+/// \return Address and size of the pages
+::std::pair<::std::uint64_t, ::std::size_t > segment_pages(
+    const ::banal::binary::component::Segment& seg) {
+  auto vaddr = seg.virtual_address() & ~static_cast<::std::uint64_t >(0xfff);
+  auto end = seg.virtual_address() +
+             ::std::max(seg.memory_size(), seg.file_size()) + PageSize - 1;
+  end &= ~static_cast<::std::uint64_t >(0xfff);
+  return {vaddr, static_cast<::std::size_t >(end - vaddr)};
+}
+
+/// \brief Fill the host memory backing a segment
+///
+/// File pages are mapped privately: pages the guest never writes stay shared
+/// with the page cache, the others are copied on write by the host kernel.
+/// When the segment is not aligned like the file, it is copied instead.
+/// Either way, the memory only holds the segment: the rest is zero.
+///
+/// \param binary The binary
+/// \param seg The segment
+/// \param host Reserved memory, from the page of the segment
+///
+/// \return true if success, else false
+bool back_segment(const ::banal::binary::Binary& binary,
+                  const ::banal::binary::component::Segment& seg,
+                  ::std::uint8_t* host) {
+  auto skip = static_cast<::std::size_t >(seg.virtual_address() % PageSize);
+  auto file_size = static_cast<::std::size_t >(seg.file_size());
+  if (file_size == 0) {
+    return true;
+  }
+  if (seg.offset() % PageSize != skip) {
+    ::std::memcpy(host + skip, binary.begin() + seg.offset(), file_size);
+    return true;
   }
+  auto head = skip + file_size;
+  auto pages = (head + PageSize - 1) / PageSize * PageSize;
+  if (::mmap(host,
+             pages,
+             PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_FIXED,
+             binary.fd(),
+             static_cast<::off_t >(seg.offset() - skip)) == MAP_FAILED) {
+    return false;
+  }
+  // the rest of the pages belongs to other segments in the file
+  ::std::memset(host, 0, skip);
+  ::std::memset(host + head, 0, pages - head);
+  return true;
+}
+
+} // end anonymous namespace
+
+bool Engine::load_segment(::banal::binary::component::Segment& seg,
+                          ::std::uint8_t* host) {
+  auto [vaddr, size] = segment_pages(seg);
   ::std::uint32_t perms = 0;
   if (seg.flags() & PF_X) {
     perms |= ::UC_PROT_EXEC;
@@ -30,35 +280,32 @@ bool Engine::load_segment(::banal::binary::component::Segment& seg) {
   if (seg.flags() & PF_W) {
     perms |= ::UC_PROT_WRITE;
   }
-  auto vaddr = seg.virtual_address() & 0xFFFFFFFFFFFFF000;
-
-  if ((seg.virtual_address() + seg.file_size()) > (vaddr + size)) {
-    // 4KB is not enough
-    size += 4096;
+  if (seg.offset() > _binary.size() ||
+      seg.file_size() > _binary.size() - seg.offset() ||
+      seg.file_size() > seg.memory_size()) {
+    ::banal::log::cerr() << "Segment " << ::std::dec << seg.index()
+                         << " is out of the binary." << ::std::endl;
+    ::munmap(host, size);
+    return false;
   }
-  _mem.emplace_back(_uc, vaddr, size, perms);
-  Map& m = _mem.back();
-  if (!m.good()) {
+  if (!back_segment(_binary, seg, host)) {
+    ::banal::log::cerr() << "Unable to map segment " << ::std::dec
+                         << seg.index() << ": " << ::std::strerror(errno)
+                         << ::std::endl;
+    ::munmap(host, size);
     return false;
   }
-
-  if (auto e = ::uc_mem_write(_uc,
-                              seg.virtual_address(),
-                              reinterpret_cast< const void* >(_binary.begin() +
-                                                              seg.offset()),
-                              seg.file_size());
-      e != ::UC_ERR_OK) {
-    // fail to copy data from file to mapped memory
-    ::banal::log::cerr() << "Unable to copy data " << ::std::dec
-                         << seg.file_size()
-                         << " bytes from binary (at offset 0x" << ::std::hex
-                         << seg.offset() << ')' << " to memory map " << m
-                         << " at 0x" << seg.virtual_address() << ": "
-                         << ::uc_strerror(e) << ::std::endl;
+  auto map = ::std::make_unique< Map >(_uc, vaddr, size, perms, host, &_cache);
+  map->source(_binary.begin() + seg.offset(),
+              static_cast<::std::size_t >(seg.virtual_address() - vaddr),
+              static_cast<::std::size_t >(seg.file_size()));
+  Map* m = _mem.add(::std::move(map));
+  if (!m) {
     return false;
   }
+
   ::banal::log::log("Segment ", ::std::dec, seg.index(), " mapped.");
-  ::banal::log::log("ENGINE: copy ",
+  ::banal::log::log("ENGINE: map ",
                     std::dec,
                     seg.file_size(),
                     " bytes from binary (",
@@ -66,29 +313,121 @@ bool Engine::load_segment(::banal::binary::component::Segment& seg) {
                     reinterpret_cast< const void* >(_binary.begin() +
                                                     seg.offset()),
                     ") to Map ",
-                    m,
+                    *m,
                     " at 0x",
                     ::std::hex,
                     seg.virtual_address());
   return true;
 }
 
-Engine::Engine(::uc_engine* uc, ::csh csh, ::banal::binary::Binary& binary)
+bool Engine::add_hook(int type,
+                      void* callback,
+                      ::std::uint64_t begin,
+                      ::std::uint64_t end,
+                      int insn) {
+  ::uc_hook hh;
+  // insn is only read by unicorn for UC_HOOK_INSN
+  if (auto e = ::uc_hook_add(_uc,
+                             &hh,
+                             type,
+                             callback,
+                             static_cast< void* >(this),
+                             begin,
+                             end,
+                             insn);
+      e != ::UC_ERR_OK) {
+    ::banal::log::cerr() << "Unable to register hook (type " << ::std::dec
+                         << type << ") on 0x" << ::std::hex << begin << "->0x"
+                         << end << ": " << ::uc_strerror(e) << ::std::endl;
+    return false;
+  }
+  _hooks.push_back(hh);
+  return true;
+}
+
+Engine::Engine(::uc_engine* uc,
+               ::csh csh,
+               ::banal::binary::Binary& binary,
+               Instrumentation mode)
     : _uc(uc),
       _csh(csh),
       _insn(nullptr),
       _binary(binary),
+      _cache(),
       _mem(),
-      _stacks(),
-      _state{binary.entry(), 0} {
+      _stack(stack_top(), ImageSize),
+      _auxv(),
+      _state{binary.entry(), 0},
+      _mode(mode),
+      _hooks(),
+      _write_hooks(),
+      _watch(Watch::None),
+      _observers(),
+      _tracer(nullptr),
+      _buffer(),
+      _input(),
+      _input_offset(0),
+      _budget(0),
+      _blocks(0),
+      _outcome{Termination::Return, ::UC_ERR_OK, 0, 0, 0, 0},
+      _sp(static_cast< int >(get_sp(binary.architecture()).second)),
+      _cs_sp(get_sp(binary.architecture()).first),
+      _exit(InsnFlags::None),
+      _exit_site(0),
+      _exit_next(0),
+      _frames(),
+      _shadow(stack_address(), StackSize),
+      _saved(),
+      _good(false) {
+  // before main is resolved, begin is the entry point
+  this->auxv();
+  ::std::vector<::banal::binary::component::Segment* > loads;
   for (auto it = binary.segments_cbegin(); it != binary.segments_cend(); it++) {
-    // Load loadable segments
-    auto& seg = *it;
-    if (seg->type() == PT_LOAD) {
-      // loadable segment
-      if (!this->load_segment(*seg)) {
-        return;
+    if ((*it)->type() == PT_LOAD) {
+      loads.push_back(it->get());
+    }
+  }
+  // the image is reserved at once, so that the host memory of neighbour
+  // segments is contiguous and their maps can be merged
+  ::std::uint64_t low = 0;
+  ::std::uint64_t high = 0;
+  for (auto* seg : loads) {
+    auto [vaddr, size] = segment_pages(*seg);
+    if (seg != loads.front() && vaddr < high) {
+      ::banal::log::cerr() << "Segment " << ::std::dec << seg->index()
+                           << " overlaps the previous one." << ::std::endl;
+      return;
+    }
+    low = seg == loads.front() ? vaddr : low;
+    high = vaddr + size;
+  }
+  ::std::uint8_t* image = nullptr;
+  if (!loads.empty()) {
+    image = reserve(static_cast<::std::size_t >(high - low));
+    if (!image) {
+      ::banal::log::cerr() << "Unable to reserve the image: "
+                           << ::std::strerror(errno) << ::std::endl;
+      return;
+    }
+  }
+  // pages between segments belong to no map
+  for (::std::size_t i = 0; i + 1 < loads.size(); i++) {
+    auto [vaddr, size] = segment_pages(*loads[i]);
+    auto next = segment_pages(*loads[i + 1]).first;
+    if (vaddr + size < next) {
+      ::munmap(image + (vaddr + size - low),
+               static_cast<::std::size_t >(next - vaddr - size));
+    }
+  }
+  for (::std::size_t i = 0; i < loads.size(); i++) {
+    if (!this->load_segment(*loads[i],
+                            image + (segment_pages(*loads[i]).first - low))) {
+      // maps own the memory of loaded segments
+      for (auto j = i + 1; j < loads.size(); j++) {
+        auto [vaddr, size] = segment_pages(*loads[j]);
+        ::munmap(image + (vaddr - low), size);
       }
+      return;
     }
   }
   ::banal::log::cgood() << "Segments loaded successfully in RAM."
@@ -97,27 +436,24 @@ Engine::Engine(::uc_engine* uc, ::csh csh, ::banal::binary::Binary& binary)
   // Find entry symbol
   // Find main
   bool f = false;
-  for (auto& [address, symbol] : binary.symbols()) {
-    if (symbol.name() == "main") {
-      auto file_offset = binary.get_address(symbol);
-      if (!file_offset) {
-        ::banal::log::cwarn() << "Symbol cannot be located" << ::std::endl;
-      } else {
-        _state.begin = symbol.value();
-        _state.end = _state.begin + symbol.size();
-        _binary.set_entry(symbol.value());
-        ::banal::log::log("Entry symbol: ",
-                          symbol.name(),
-                          ", size=0x",
-                          ::std::hex,
-                          symbol.size(),
-                          ", virtual address = 0x",
-                          ::std::hex,
-                          symbol.value(),
-                          ", offset file = 0x",
-                          *file_offset);
-        f = true;
-      }
+  if (auto symbol = binary.find_symbol("main")) {
+    auto file_offset = binary.get_address(*symbol);
+    if (!file_offset) {
+      ::banal::log::cwarn() << "Symbol cannot be located" << ::std::endl;
+    } else {
+      // the binary is shared by engines, it keeps its own entry point
+      _state.begin = symbol->value();
+      ::banal::log::log("Entry symbol: ",
+                        symbol->name(),
+                        ", size=0x",
+                        ::std::hex,
+                        symbol->size(),
+                        ", virtual address = 0x",
+                        ::std::hex,
+                        symbol->value(),
+                        ", offset file = 0x",
+                        *file_offset);
+      f = true;
     }
   }
   if (!f) {
@@ -134,54 +470,223 @@ Engine::Engine(::uc_engine* uc, ::csh csh, ::banal::binary::Binary& binary)
     return;
   }
 
-  // init stack
-  uintarch_t stack_addr = ::banal::stack();
+  // init stack, reserved: pages are materialized as it grows, down to a
+  // guard page
   ::std::uint32_t perms = ::UC_PROT_READ | ::UC_PROT_WRITE;
-  if (_binary.nx()) {
-    perms |= ::UC_PROT_WRITE;
+  if (!_binary.nx()) {
+    perms |= ::UC_PROT_EXEC;
   }
-  _mem.emplace_back(_uc, stack_addr, 4096, perms);
-  stack_addr += 4096 - sizeof(uintarch_t) * 10;
-  switch (binary.architecture()) {
-    case ::banal::Architecture::X86: {
-      ::uc_reg_write(_uc, ::UC_X86_REG_ESP, &stack_addr);
-    } break;
-    case ::banal::Architecture::X86_64: {
-      ::uc_reg_write(_uc, ::UC_X86_REG_RSP, &stack_addr);
-    } break;
-    default: {
-      ::banal::log::unreachable("Unreachable");
-    }
+  auto* stack_host = reserve(StackSize);
+  if (!stack_host) {
+    ::banal::log::cerr() << "Unable to reserve the stack: "
+                         << ::std::strerror(errno) << ::std::endl;
+    return;
+  }
+  if (!_mem.add(::std::make_unique< Map >(
+          _uc, stack_address(), StackSize, perms, stack_host, &_cache))) {
+    return;
+  }
+  if (!_mem.add(::std::make_unique< Map >(
+          _uc, guard_address(), PageSize, ::UC_PROT_NONE, &_cache))) {
+    return;
   }
+  uintarch_t stack_addr = stack_top();
+  ::uc_reg_write(_uc, _sp, &stack_addr);
 
-  // hook code
-  ::uc_hook hh;
-  ::uc_cb_hookcode_t code_hook = Engine::hook_insn;
+  // main returns to a hlt, emulation stops before executing it
+  if (!_mem.add(::std::make_unique< Map >(_uc,
+                                          exit_address(),
+                                          PageSize,
+                                          ::UC_PROT_READ | ::UC_PROT_EXEC,
+                                          &_cache))) {
+    return;
+  }
+  const ::std::uint8_t hlt = 0xf4;
+  if (!this->write(exit_address(), &hlt, sizeof(hlt))) {
+    return;
+  }
+  _state.end = exit_address();
+
+  // hook blocks and writes to writable memory, instructions are only hooked
+  // when traced
+  ::uc_cb_hookcode_t block_hook = Engine::hook_block;
+  ::uc_cb_eventmem_t unmapped_hook = Engine::hook_unmapped;
+  ::uc_cb_insn_syscall_t syscall_hook = Engine::hook_syscall;
+  ::uc_cb_hookintr_t interrupt_hook = Engine::hook_interrupt;
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wc++98-compat-pedantic"
-  if (auto e = ::uc_hook_add(_uc,
-                             &hh,
-                             ::UC_HOOK_CODE,
-                             reinterpret_cast< void* >(code_hook),
-                             static_cast< void* >(this),
-                             1,
-                             0);
-      e != ::UC_ERR_OK) {
-#pragma clang diagnostic pop
-    ::banal::log::cerr() << "Unable to register code hook: " << ::uc_strerror(e)
-                         << ::std::endl;
+  if (!this->scope()) {
+    return;
+  }
+  if (!this->add_hook(UC_HOOK_MEM_UNMAPPED,
+                      reinterpret_cast< void* >(unmapped_hook),
+                      1,
+                      0)) {
+    return;
+  }
+  if (!this->add_hook(
+          ::UC_HOOK_BLOCK, reinterpret_cast< void* >(block_hook), 1, 0)) {
+    return;
+  }
+  if (arch64() ? !this->add_hook(::UC_HOOK_INSN,
+                                 reinterpret_cast< void* >(syscall_hook),
+                                 1,
+                                 0,
+                                 ::UC_X86_INS_SYSCALL)
+               : !this->add_hook(::UC_HOOK_INTR,
+                                 reinterpret_cast< void* >(interrupt_hook),
+                                 1,
+                                 0)) {
     return;
   }
+#pragma clang diagnostic pop
+  _good = true;
 }
 
-bool Engine::emulate(void) {
-  auto e = ::uc_emu_start(_uc, _state.begin, _state.end, 0, 0);
-  if (e != ::UC_ERR_OK) {
-    ::banal::log::cerr() << "Unable emulate code: " << ::uc_strerror(e)
-                         << ::std::endl;
+void Engine::auxv(void) {
+  _auxv.clear();
+  ::std::size_t phnum = 0;
+  for (auto it = _binary.segments_cbegin(); it != _binary.segments_cend();
+       it++) {
+    const auto& seg = *it;
+    if (seg->type() == PT_PHDR) {
+      _auxv.push_back(Aux::Phdr);
+      _auxv.push_back(static_cast< uintarch_t >(seg->virtual_address()));
+    }
+    phnum++;
+  }
+  _auxv.insert(
+      _auxv.end(),
+      {Aux::Phent,
+       static_cast< uintarch_t >(arch64() ? 56 : 32),
+       Aux::Phnum,
+       static_cast< uintarch_t >(phnum),
+       Aux::Pagesz,
+       static_cast< uintarch_t >(PageSize),
+       Aux::Flags,
+       0,
+       Aux::Entry,
+       static_cast< uintarch_t >(_state.begin),
+       Aux::Uid,
+       1000,
+       Aux::Euid,
+       1000,
+       Aux::Gid,
+       1000,
+       Aux::Egid,
+       1000,
+       Aux::Clktck,
+       100,
+       Aux::Secure,
+       0});
+}
+
+bool Engine::prepare(const Input& input) {
+  // laid out like the kernel does, from the top: the strings, then the
+  // auxiliary vector, envp (empty), argv and argc
+  _stack.clear();
+  ::std::vector< uintarch_t > argv;
+  if (!_stack.push(uintarch_t{0}) ||
+      !_stack.push(Platform, sizeof(Platform))) {
+    return false;
+  }
+  auto platform = _stack.sp();
+  for (auto it = input.args.rbegin(); it != input.args.rend(); it++) {
+    if (!_stack.push(it->c_str(), it->size() + 1)) {
+      return false;
+    }
+    argv.push_back(_stack.sp());
+  }
+  ::std::reverse(argv.begin(), argv.end());
+  if (!_stack.align(16) || !_stack.push(Random, sizeof(Random))) {
+    return false;
+  }
+  auto random = _stack.sp();
+
+  auto argc = static_cast< uintarch_t >(argv.size());
+  ::std::vector< uintarch_t > table;
+  table.reserve(argv.size() + _auxv.size() + 10);
+  table.push_back(argc);
+  table.insert(table.end(), argv.begin(), argv.end());
+  table.push_back(0);
+  auto envp_index = table.size();
+  table.push_back(0);
+  table.insert(table.end(), _auxv.begin(), _auxv.end());
+  table.insert(table.end(),
+               {Aux::Random,
+                random,
+                Aux::Platform,
+                platform,
+                Aux::Execfn,
+                argv.empty() ? 0 : argv[0],
+                Aux::Null,
+                0});
+  // argc is 16 bytes aligned
+  if (!_stack.align(16) ||
+      ((table.size() * sizeof(uintarch_t)) % 16 && !_stack.push(0)) ||
+      !_stack.push(table.data(), table.size() * sizeof(uintarch_t))) {
+    return false;
+  }
+  auto argv_address = _stack.sp() + static_cast< uintarch_t >(sizeof(argc));
+  auto envp = _stack.sp() +
+              static_cast< uintarch_t >(envp_index * sizeof(uintarch_t));
+
+  // main is called by the C runtime, and returns to the exit page
+#if ARCH_SIZE == ARCH_SIZE_64
+  if (!_stack.push(exit_address())) {
+    return false;
+  }
+  ::uc_reg_write(_uc, ::UC_X86_REG_RDI, &argc);
+  ::uc_reg_write(_uc, ::UC_X86_REG_RSI, &argv_address);
+  ::uc_reg_write(_uc, ::UC_X86_REG_RDX, &envp);
+#else
+  // cdecl: right after the return address, aligned on 16 bytes
+  if (!_stack.push(0) || !_stack.push(envp) ||
+      !_stack.push(argv_address) || !_stack.push(argc) ||
+      !_stack.push(exit_address())) {
+    return false;
+  }
+#endif
+  if (!this->write(_stack.sp(), _stack.data(), _stack.size())) {
     return false;
   }
+  auto sp = _stack.sp();
+  ::uc_reg_write(_uc, _sp, &sp);
+
+  _input.assign(input.data.begin(), input.data.end());
+  _input_offset = 0;
   return true;
+}
+
+bool Engine::emulate(::std::size_t budget) {
+  _exit = InsnFlags::None;
+  _frames.clear();
+  _shadow.clear();
+  // main is called by the C runtime, its return address is the exit page
+  auto sp = this->sp();
+  _frames.push_back(
+      Frame{exit_address(), sp, static_cast< uintarch_t >(_state.begin), 0});
+  if (_watch & Watch::Shadow) {
+    _shadow.poison(sp, 1, Poison::Return);
+  }
+  _saved.clear();
+  _budget = budget;
+  _blocks = 0;
+  _outcome = {Termination::Return, ::UC_ERR_OK, 0, 0, 0, 0};
+  if (auto e = ::uc_emu_start(_uc, _state.begin, _state.end, 0, 0);
+      e != ::UC_ERR_OK) {
+    _outcome.reason = Termination::Fault;
+    _outcome.error = e;
+    ::uc_reg_read(_uc, get_ip(_binary.architecture()).second, &_outcome.pc);
+    return false;
+  }
+  if (_outcome.reason == Termination::Return) {
+    ::uc_reg_read(_uc, SyscallRegs[0], &_outcome.code);
+  }
+  return _outcome.reason != Termination::Fault &&
+         _outcome.reason != Termination::Smash &&
+         _outcome.reason != Termination::Overflow &&
+         _outcome.reason != Termination::Escape;
   /*if (auto b = ::cs_disasm_iter(_csh,
                                 &_state.cs.cursor,
                                 &_state.cs.size,
@@ -196,6 +701,12 @@ bool Engine::emulate(void) {
 }
 
 Engine::~Engine(void) {
+  for (auto hh : _hooks) {
+    if (auto e = ::uc_hook_del(_uc, hh); e != ::UC_ERR_OK) {
+      ::banal::log::cerr() << "Unable to delete hook: " << ::uc_strerror(e)
+                           << ::std::endl;
+    }
+  }
   if (_insn) {
     ::cs_free(_insn, 1);
   }
@@ -208,6 +719,115 @@ void Engine::stop(void) {
   }
 }
 
+::std::unique_ptr< Snapshot > Engine::snapshot(void) {
+  auto snapshot = ::std::make_unique< Snapshot >(_uc);
+  if (!snapshot->save(_mem)) {
+    return nullptr;
+  }
+  return snapshot;
+}
+
+bool Engine::restore(const Snapshot& snapshot) {
+  for (auto it = _mem.cbegin(); it != _mem.cend(); it++) {
+    const auto& m = *it->second;
+    if ((m.perms() & ::UC_PROT_EXEC) && (m.perms() & ::UC_PROT_WRITE)) {
+      // code is going to be restored
+      for (::std::size_t page = 0; page < m.pages(); page++) {
+        if (m.dirty(page)) {
+          auto address = m.address() + page * PageSize;
+          _cache.invalidate(address, address + PageSize);
+        }
+      }
+    }
+  }
+  return snapshot.restore(_mem);
+}
+
+void Engine::attach(Observer& observer) {
+  _observers.push_back(&observer);
+}
+
+bool Engine::trace(Tracer& tracer) {
+  ::uc_cb_hookcode_t code_hook = Engine::hook_insn;
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wc++98-compat-pedantic"
+  if (_mode == Instrumentation::Instruction && !_tracer &&
+      !this->add_hook(
+          ::UC_HOOK_CODE, reinterpret_cast< void* >(code_hook), 1, 0)) {
+    return false;
+  }
+#pragma clang diagnostic pop
+  _tracer = &tracer;
+  if (!this->scope()) {
+    _tracer = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool Engine::watch(::std::uint8_t watch) {
+  if ((watch & Watch::Shadow) && !_shadow.good()) {
+    return false;
+  }
+  _watch = watch;
+  return this->scope();
+}
+
+bool Engine::scope(void) {
+  while (!_write_hooks.empty()) {
+    // a hook which cannot be deleted is kept, so that it is deleted later
+    auto hh = _write_hooks.back();
+    if (auto e = ::uc_hook_del(_uc, hh); e != ::UC_ERR_OK) {
+      ::banal::log::cerr() << "Unable to delete write hook: "
+                           << ::uc_strerror(e) << ::std::endl;
+      return false;
+    }
+    _hooks.erase(::std::find(_hooks.begin(), _hooks.end(), hh));
+    _write_hooks.pop_back();
+  }
+  auto watch = _tracer ? _watch | Watch::Stack | Watch::Data : _watch;
+  ::uc_cb_hookmem_t write_hook = Engine::hook_write;
+  for (auto it = _mem.begin(); it != _mem.end(); it++) {
+    auto& m = *it->second;
+    if (!(m.perms() & ::UC_PROT_WRITE)) {
+      continue;
+    }
+    bool stack = m.address() >= stack_address() &&
+                 m.address() + m.size() <= stack_top();
+    bool hooked =
+        (m.perms() & ::UC_PROT_EXEC) ||
+        (watch & (stack ? Watch::Stack | Watch::Shadow | Watch::Frames
+                        : Watch::Data));
+    m.track(hooked);
+    if (!hooked) {
+      continue;
+    }
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wc++98-compat-pedantic"
+    if (!this->add_hook(::UC_HOOK_MEM_WRITE,
+                        reinterpret_cast< void* >(write_hook),
+                        m.address(),
+                        m.address() + m.size() - 1)) {
+      return false;
+    }
+#pragma clang diagnostic pop
+    _write_hooks.push_back(_hooks.back());
+  }
+  return true;
+}
+
+uintarch_t Engine::sp(void) const {
+  uintarch_t value = 0;
+  ::uc_reg_read(_uc, _sp, &value);
+  return value;
+}
+
+uintarch_t Engine::pc(void) const {
+  uintarch_t value = 0;
+  ::uc_reg_read(_uc, get_ip(_binary.architecture()).second, &value);
+  return value;
+}
+
 void Engine::hook_insn(::uc_engine*,
                        ::std::uint64_t address,
                        ::std::uint32_t size,
@@ -217,31 +837,438 @@ void Engine::hook_insn(::uc_engine*,
                static_cast<::std::size_t >(size));
 }
 
-void Engine::hook_insn(uintarch_t address, ::std::size_t size) {
-  ::std::vector<::std::uint8_t > insn_buffer;
-  insn_buffer.reserve(size);
-  if (auto e = ::uc_mem_read(_uc,
-                             static_cast<::std::uint64_t >(address),
-                             insn_buffer.data(),
-                             size);
-      e != ::UC_ERR_OK) {
-    ::banal::log::cerr() << "Unable to read instruction at 0x" << ::std::hex
-                         << address << ": " << ::uc_strerror(e) << ::std::endl;
-    this->stop();
-    return;
+void Engine::hook_block(::uc_engine*,
+                        ::std::uint64_t address,
+                        ::std::uint32_t size,
+                        void* user_data) {
+  Engine* e = static_cast< Engine* >(user_data);
+  e->hook_block(static_cast< uintarch_t >(address),
+                static_cast<::std::size_t >(size));
+}
+
+void Engine::hook_syscall(::uc_engine*, void* user_data) {
+  Engine* e = static_cast< Engine* >(user_data);
+  e->syscall();
+}
+
+void Engine::hook_interrupt(::uc_engine*,
+                            ::std::uint32_t intno,
+                            void* user_data) {
+  Engine* e = static_cast< Engine* >(user_data);
+  if (intno == SyscallInterrupt) {
+    e->syscall();
+  }
+}
+
+bool Engine::hook_unmapped(::uc_engine*,
+                           ::uc_mem_type,
+                           ::std::uint64_t address,
+                           int size,
+                           ::std::int64_t,
+                           void* user_data) {
+  Engine* e = static_cast< Engine* >(user_data);
+  if (!e->fault(address, static_cast<::std::size_t >(size))) {
+    return false;
+  }
+  ::banal::log::log("ENGINE: 0x", ::std::hex, address, " materialized.");
+  return true;
+}
+
+void Engine::hook_write(::uc_engine*,
+                        ::uc_mem_type,
+                        ::std::uint64_t address,
+                        int size,
+                        ::std::int64_t,
+                        void* user_data) {
+  Engine* e = static_cast< Engine* >(user_data);
+  auto len = static_cast<::std::size_t >(size);
+  if (e->_tracer) {
+    e->_tracer->push(Record{address,
+                            static_cast<::std::uint32_t >(size),
+                            0,
+                            RecordKind::Write,
+                            InsnFlags::Store,
+                            {}});
+  }
+  if (Map* m = e->map(address); m) {
+    m->mark(address, len);
+    if (m->perms() & ::UC_PROT_EXEC) {
+      // guest modifies its own code
+      e->_cache.invalidate(address, address + len);
+    }
+  }
+  auto at = static_cast< uintarch_t >(address);
+  if (((e->_watch & Watch::Shadow) && !e->check_shadow(at, len)) ||
+      ((e->_watch & Watch::Frames) && !e->check_frames(at, len))) {
+    e->stop();
+  }
+}
+
+Map* Engine::map(::std::uint64_t address) {
+  return _mem.find(address);
+}
+
+const ::std::uint8_t* Engine::memory(::std::uint64_t address,
+                                     ::std::size_t size) {
+  if (Map* m = this->map(address); m) {
+    return m->host(address, size);
+  }
+  return nullptr;
+}
+
+bool Engine::fault(::std::uint64_t address, ::std::size_t size) {
+  Map* m = this->map(address);
+  if (!m || !m->fault(address, size)) {
+    return false;
+  }
+  // the range may go on in the next map
+  auto end = m->address() + m->size();
+  if (size > 0 && address + size > end) {
+    return this->fault(end, static_cast<::std::size_t >(address + size - end));
+  }
+  return true;
+}
+
+bool Engine::write(::std::uint64_t address,
+                   const void* data,
+                   ::std::size_t size) {
+  // reserved memory has to be materialized, host writes are not hooked
+  this->fault(address, size);
+  if (auto e = ::uc_mem_write(_uc, address, data, size); e != ::UC_ERR_OK) {
+    ::banal::log::cerr() << "Unable to write " << ::std::dec << size
+                         << " bytes at 0x" << ::std::hex << address << ": "
+                         << ::uc_strerror(e) << ::std::endl;
+    return false;
+  }
+  // unicorn does not hook writes made by the host
+  if (Map* m = this->map(address); m) {
+    m->mark(address, size);
+  }
+  return true;
+}
+
+void Engine::syscall(void) {
+  uintarch_t regs[4] = {};
+  for (::std::size_t i = 0; i < 4; i++) {
+    ::uc_reg_read(_uc, SyscallRegs[i], &regs[i]);
+  }
+  auto fd = regs[1];
+  auto buf = regs[2];
+  auto count = static_cast<::std::size_t >(regs[3]);
+  uintarch_t ret = 0;
+  switch (regs[0]) {
+    case Syscall::Read: {
+      if (fd != 0) {
+        // nothing to read from other files
+        break;
+      }
+      auto n = ::std::min(count, _input.size() - _input_offset);
+      if (n > 0 && !this->write(buf, _input.data() + _input_offset, n)) {
+        ret = -static_cast< uintarch_t >(Errno::Fault);
+        break;
+      }
+      _input_offset += n;
+      ret = static_cast< uintarch_t >(n);
+    } break;
+    case Syscall::Write: {
+      // output is discarded
+      ret = static_cast< uintarch_t >(count);
+    } break;
+    case Syscall::Exit:
+    case Syscall::ExitGroup: {
+      _outcome.reason = Termination::Exit;
+      _outcome.code = fd;
+      this->stop();
+      return;
+    }
+    default: {
+      ret = -static_cast< uintarch_t >(Errno::NoSys);
+    }
+  }
+  ::uc_reg_write(_uc, SyscallRegs[0], &ret);
+}
+
+const Insn* Engine::decode(uintarch_t address, ::std::size_t size) {
+  // x86 instructions are at most 15 bytes long
+  ::std::uint8_t insn_buffer[16];
+  if (size > sizeof(insn_buffer)) {
+    size = sizeof(insn_buffer);
   }
   ::std::uint64_t addr = static_cast<::std::uint64_t >(address);
-  const ::std::uint8_t* data = insn_buffer.data();
+  const ::std::uint8_t* data = this->memory(addr, size);
+  if (!data) {
+    if (auto e = ::uc_mem_read(_uc, addr, insn_buffer, size);
+        e != ::UC_ERR_OK) {
+      ::banal::log::cerr() << "Unable to read instruction at 0x" << ::std::hex
+                           << address << ": " << ::uc_strerror(e)
+                           << ::std::endl;
+      return nullptr;
+    }
+    data = insn_buffer;
+  }
   if (auto b = ::cs_disasm_iter(_csh, &data, &size, &addr, _insn); !b) {
     ::banal::log::cerr() << "Unable to disassemble instruction at 0x"
                          << ::std::hex << address << ": "
                          << ::cs_strerror(::cs_errno(_csh)) << ::std::endl;
+    return nullptr;
+  }
+  auto [flags, delta] = classify(_csh, *_insn, _cs_sp);
+  return &_cache.insert(*_insn, flags, delta);
+}
+
+const Block* Engine::decode_block(uintarch_t address, ::std::size_t size) {
+  ::std::vector< Insn > insns;
+  ::std::uint64_t addr = static_cast<::std::uint64_t >(address);
+  if (size == 0) {
+    // unicorn does not always know the size of the block: decode until the
+    // control flow changes
+    for (;;) {
+      const Insn* insn = _cache.find(addr);
+      if (!insn) {
+        insn = this->decode(static_cast< uintarch_t >(addr), 16);
+        if (!insn) {
+          return nullptr;
+        }
+      }
+      insns.push_back(*insn);
+      addr += insn->size;
+      if (insn->flags & (InsnFlags::Call | InsnFlags::Ret | InsnFlags::Jump)) {
+        break;
+      }
+    }
+    return &_cache.insert_block(
+        address, static_cast<::std::uint32_t >(addr - address), insns);
+  }
+
+  const ::std::uint8_t* data = this->memory(addr, size);
+  if (!data) {
+    _buffer.resize(size);
+    if (auto e = ::uc_mem_read(_uc, addr, _buffer.data(), size);
+        e != ::UC_ERR_OK) {
+      ::banal::log::cerr() << "Unable to read block at 0x" << ::std::hex
+                           << address << ": " << ::uc_strerror(e)
+                           << ::std::endl;
+      return nullptr;
+    }
+    data = _buffer.data();
+  }
+  ::std::size_t left = size;
+  while (left > 0) {
+    if (const Insn* insn = _cache.find(addr); insn && insn->size <= left) {
+      insns.push_back(*insn);
+      data += insn->size;
+      addr += insn->size;
+      left -= insn->size;
+      continue;
+    }
+    if (auto b = ::cs_disasm_iter(_csh, &data, &left, &addr, _insn); !b) {
+      ::banal::log::cerr() << "Unable to disassemble instruction at 0x"
+                           << ::std::hex << addr << ": "
+                           << ::cs_strerror(::cs_errno(_csh)) << ::std::endl;
+      return nullptr;
+    }
+    auto [flags, delta] = classify(_csh, *_insn, _cs_sp);
+    insns.push_back(_cache.insert(*_insn, flags, delta));
+  }
+  return &_cache.insert_block(
+      address, static_cast<::std::uint32_t >(size), insns);
+}
+
+void Engine::hook_insn(uintarch_t address, ::std::size_t size) {
+  const Insn* insn = _cache.find(static_cast<::std::uint64_t >(address));
+  if (!insn) {
+    insn = this->decode(address, size);
+    if (!insn) {
+      _outcome = {Termination::Fault, ::UC_ERR_INSN_INVALID, address, 0, 0, 0};
+      this->stop();
+      return;
+    }
+  }
+  if (_tracer) {
+    Record record{static_cast<::std::uint64_t >(address),
+                  insn->size,
+                  insn->id,
+                  RecordKind::Insn,
+                  insn->flags,
+                  {}};
+    // the tracer decodes the bytes again, for the operands
+    auto len = ::std::min< ::std::size_t >(insn->size, sizeof(record.bytes));
+    if (const auto* data = this->memory(record.address, len); data) {
+      ::std::memcpy(record.bytes, data, len);
+    } else {
+      ::uc_mem_read(_uc, record.address, record.bytes, len);
+    }
+    _tracer->push(record);
+  }
+}
+
+bool Engine::check_ret(uintarch_t target, uintarch_t sp) {
+  auto frame = _frames.end();
+  while (frame != _frames.begin() && ::std::prev(frame)->sp < sp) {
+    frame--;
+  }
+  if (frame == _frames.end()) {
+    return true;
+  }
+  auto ret = frame->ret;
+  auto callee = frame->callee;
+  _frames.erase(frame, _frames.end());
+  if (ret == target) {
+    return true;
+  }
+  _outcome = {
+      Termination::Smash, ::UC_ERR_OK, _exit_site, target, callee, 0};
+  return false;
+}
+
+::std::size_t Engine::depth_of(uintarch_t address) const {
+  if (_frames.empty() || _frames.back().sp + WordSize > address) {
+    return _frames.size();
+  }
+  // frames end lower and lower
+  auto it = ::std::partition_point(
+      _frames.begin(), _frames.end(), [address](const Frame& f) {
+        return f.sp + WordSize > address;
+      });
+  return static_cast<::std::size_t >(it - _frames.begin());
+}
+
+uintarch_t Engine::function_at(::std::size_t depth) const {
+  return depth > 0 ? _frames[depth - 1].callee : 0;
+}
+
+bool Engine::check_shadow(uintarch_t address, ::std::size_t size) {
+  auto hit = _shadow.check(address, size);
+  if (hit && *hit < this->sp()) {
+    // left by frames abandoned without a return (longjmp)
+    _shadow.retire(this->sp());
+    hit = _shadow.check(address, size);
+  }
+  if (!hit) {
+    return true;
+  }
+  _outcome = {Termination::Overflow,
+              ::UC_ERR_OK,
+              this->pc(),
+              *hit,
+              this->function_at(this->depth_of(*hit)),
+              0};
+  return false;
+}
+
+bool Engine::check_frames(uintarch_t address, ::std::size_t size) {
+  auto end = address + static_cast< uintarch_t >(size);
+  auto depth = this->depth_of(address);
+  if (depth > 0) {
+    auto& frame = _frames[depth - 1];
+    if (end > frame.sp) {
+      frame.reach = ::std::max(frame.reach, end);
+    }
+    if (end > frame.sp + WordSize) {
+      // from the frame, past its return address
+      depth--;
+    }
+  }
+  if (depth == _frames.size() || _frames[depth].reach < address) {
+    // in the frame, or not contiguous to a breach below
+    return true;
+  }
+  const auto& frame = _frames[depth];
+  _outcome = {Termination::Escape,
+              ::UC_ERR_OK,
+              this->pc(),
+              end - (frame.sp + WordSize),
+              frame.callee,
+              this->function_at(depth)};
+  return false;
+}
+
+void Engine::shadow(const Block& block, uintarch_t sp) {
+  if (_exit & InsnFlags::Ret) {
+    _shadow.retire(sp);
+  } else if (_exit & InsnFlags::Call) {
+    _shadow.poison(sp, 1, Poison::Return);
+    // only instructions writing memory or adjusting the stack pointer are
+    // kept by blocks: endbr and mov bp, sp are not there
+    const Insn* insns = _cache.insns(block);
+    auto at = sp;
+    for (::std::uint32_t i = 0; i < block.count; i++) {
+      const auto& insn = insns[i];
+      if (insn.id == ::X86_INS_PUSH) {
+        at -= static_cast< uintarch_t >(Shadow::Slot);
+        if (insn.flags & InsnFlags::Save) {
+          _saved.push_back(at);
+        }
+      } else if (insn.flags & InsnFlags::StackAdjust) {
+        at += static_cast< uintarch_t >(insn.delta);
+      } else {
+        // the prologue is over
+        break;
+      }
+    }
+  }
+}
+
+void Engine::hook_block(uintarch_t address, ::std::size_t size) {
+  if (_budget && ++_blocks > _budget) {
+    _outcome.reason = Termination::Budget;
     this->stop();
     return;
   }
-  ::banal::log::cinfo() << CODE_YELLOW << "[0x" << ::std::hex << address
-                        << "]> " << CODE_RESET << _insn->mnemonic << '\t'
-                        << _insn->op_str << ::std::endl;
+  const Block* block =
+      _cache.find_block(static_cast<::std::uint64_t >(address));
+  if (!block) {
+    block = this->decode_block(address, size);
+    if (!block) {
+      _outcome = {Termination::Fault, ::UC_ERR_INSN_INVALID, address, 0, 0, 0};
+      this->stop();
+      return;
+    }
+  }
+
+  if (!_saved.empty()) {
+    // the first block of the called function has pushed them
+    for (auto at : _saved) {
+      _shadow.poison(at, 1, Poison::Saved);
+    }
+    _saved.clear();
+  }
+
+  // the previous block has left through a call or a return
+  if (_exit & (InsnFlags::Call | InsnFlags::Ret)) {
+    auto sp = this->sp();
+    if (_exit & InsnFlags::Call) {
+      // frames at or below the new one have been left without a return
+      while (!_frames.empty() && _frames.back().sp <= sp) {
+        _frames.pop_back();
+      }
+      _frames.push_back(Frame{_exit_next, sp, address, 0});
+    } else if (!this->check_ret(address, sp)) {
+      this->stop();
+      return;
+    }
+    if (_watch & Watch::Shadow) {
+      this->shadow(*block, sp);
+    }
+    for (auto* o : _observers) {
+      if (_exit & InsnFlags::Call) {
+        o->on_call(*this, _exit_site, address, sp);
+      } else {
+        o->on_ret(*this, _exit_site, address, sp);
+      }
+    }
+  }
+  _exit = block->exit;
+  _exit_site = static_cast< uintarch_t >(block->last);
+  _exit_next = static_cast< uintarch_t >(block->address + block->size);
+  if (_tracer) {
+    _tracer->push(Record{
+        block->address, block->size, 0, RecordKind::Block, block->flags, {}});
+  }
+
+  for (auto* o : _observers) {
+    o->on_block(*this, *block);
+  }
 }
 
 } // end namespace execution
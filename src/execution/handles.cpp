@@ -0,0 +1,62 @@
+///
+/// \file
+/// \brief Capstone and Unicorn handles implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include "banal/execution/handles.hpp"
+#include "banal/util/log.hpp"
+
+namespace banal {
+namespace execution {
+
+Handles::Handles(Architecture architecture)
+    : _csh(0), _uc(nullptr), _good(false) {
+  auto capstone_value = get_cs_architecture(architecture);
+  if (auto e = ::cs_open(capstone_value.first, capstone_value.second, &_csh);
+      e != ::CS_ERR_OK) {
+    ::banal::log::cerr() << "Unable to initialize Capstone engine: "
+                         << ::cs_strerror(e) << ::std::endl;
+    _csh = 0;
+    return;
+  }
+  ::banal::log::log("Capstone handler = ", _csh);
+
+  auto uc_value = get_uc_architecture(architecture);
+  if (auto e = ::uc_open(uc_value.first, uc_value.second, &_uc);
+      e != ::UC_ERR_OK) {
+    ::banal::log::cerr() << "Unable to initialize Unicorn engine: "
+                         << ::uc_strerror(e) << ::std::endl;
+    _uc = nullptr;
+    return;
+  }
+  ::banal::log::log("Unicorn engine handler = ", _uc);
+  _good = true;
+}
+
+Handles::Handles(Handles&& h) : _csh(h._csh), _uc(h._uc), _good(h._good) {
+  h._csh = 0;
+  h._uc = nullptr;
+  h._good = false;
+}
+
+Handles::~Handles(void) {
+  if (_csh) {
+    if (auto e = ::cs_close(&_csh); e != ::CS_ERR_OK) {
+      ::banal::log::cerr() << "Unable to close capstone engine: "
+                           << ::cs_strerror(e) << ::std::endl;
+    }
+  }
+  if (_uc) {
+    if (auto e = ::uc_close(_uc); e != ::UC_ERR_OK) {
+      ::banal::log::cerr() << "Unable to close unicorn engine: "
+                           << ::uc_strerror(e) << ::std::endl;
+    }
+    _uc = nullptr;
+  }
+}
+
+} // end namespace execution
+} // end namespace banal
@@ -0,0 +1,199 @@
+///
+/// \file
+/// \brief Decoded instruction cache implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <algorithm>
+#include <cstring>
+
+#include "banal/execution/insn_cache.hpp"
+
+namespace banal {
+namespace execution {
+
+namespace {
+
+/// \brief Initial size of the lookup tables
+constexpr ::std::size_t InitialSlots = 1024;
+
+/// \brief Flags of the instructions a block keeps
+constexpr ::std::uint8_t BlockFlags = InsnFlags::Call | InsnFlags::Ret |
+                                      InsnFlags::Store |
+                                      InsnFlags::StackAdjust;
+
+} // end anonymous namespace
+
+InsnCache::Table::Table(void) : _slots(InitialSlots, Slot{0, 0}), _used(0) {}
+
+void InsnCache::Table::insert(::std::uint64_t address, ::std::uint32_t index) {
+  // keep the load factor under 1/2
+  if ((_used + 1) * 2 > _slots.size()) {
+    auto old = ::std::move(_slots);
+    _slots.assign(old.size() * 2, Slot{0, 0});
+    _used = 0;
+    for (const auto& slot : old) {
+      if (slot.index) {
+        this->insert(slot.address, slot.index - 1);
+      }
+    }
+  }
+
+  auto mask = _slots.size() - 1;
+  for (auto i = Table::hash(address) & mask;; i = (i + 1) & mask) {
+    auto& slot = _slots[i];
+    if (slot.index == 0) {
+      _used++;
+    }
+    if (slot.index == 0 || slot.address == address) {
+      slot.address = address;
+      slot.index = index + 1;
+      return;
+    }
+  }
+}
+
+void InsnCache::Table::clear(void) {
+  ::std::fill(_slots.begin(), _slots.end(), Slot{0, 0});
+  _used = 0;
+}
+
+InsnCache::InsnCache(void)
+    : _insns_table(),
+      _insns(),
+      _text(),
+      _blocks_table(),
+      _blocks(),
+      _blocks_insns(),
+      _low(UINT64_MAX),
+      _high(0) {}
+
+const Insn& InsnCache::insert(const ::cs_insn& insn,
+                              ::std::uint8_t flags,
+                              ::std::int32_t delta) {
+  Insn i;
+  i.address = insn.address;
+  i.text = static_cast<::std::uint32_t >(_text.size());
+  i.delta = delta;
+  i.id = static_cast<::std::uint16_t >(insn.id);
+  i.size = static_cast<::std::uint8_t >(insn.size);
+  i.flags = flags;
+
+  _text.insert(_text.end(),
+               insn.mnemonic,
+               insn.mnemonic + ::std::strlen(insn.mnemonic));
+  _text.push_back('\t');
+  _text.insert(_text.end(),
+               insn.op_str,
+               insn.op_str + ::std::strlen(insn.op_str) + 1);
+
+  _low = ::std::min(_low, i.address);
+  _high = ::std::max(_high, i.address + i.size);
+
+  _insns.push_back(i);
+  _insns_table.insert(i.address,
+                      static_cast<::std::uint32_t >(_insns.size() - 1));
+  return _insns.back();
+}
+
+const Block& InsnCache::insert_block(
+    ::std::uint64_t address,
+    ::std::uint32_t size,
+    const ::std::vector< Insn >& insns) {
+  Block b;
+  b.address = address;
+  b.last = address;
+  b.size = size;
+  b.first = static_cast<::std::uint32_t >(_blocks_insns.size());
+  b.count = 0;
+  b.flags = InsnFlags::None;
+  b.exit = InsnFlags::None;
+  if (!insns.empty()) {
+    b.last = insns.back().address;
+    b.exit = insns.back().flags;
+  }
+  for (const auto& insn : insns) {
+    b.flags |= insn.flags;
+    if (insn.flags & BlockFlags) {
+      _blocks_insns.push_back(insn);
+      b.count++;
+    }
+  }
+
+  _low = ::std::min(_low, address);
+  _high = ::std::max(_high, address + size);
+
+  _blocks.push_back(b);
+  _blocks_table.insert(address,
+                       static_cast<::std::uint32_t >(_blocks.size() - 1));
+  return _blocks.back();
+}
+
+void InsnCache::invalidate(::std::uint64_t begin, ::std::uint64_t end) {
+  if (end <= _low || begin >= _high) {
+    // fast path: nothing cached there
+    return;
+  }
+  auto overlaps = [begin, end](const auto& v) {
+    return v.address < end && v.address + v.size > begin;
+  };
+  if (::std::none_of(_insns.begin(), _insns.end(), overlaps) &&
+      ::std::none_of(_blocks.begin(), _blocks.end(), overlaps)) {
+    return;
+  }
+
+  // rebuild the whole cache, keeping only what is outside the range
+  ::std::vector< Insn > insns;
+  ::std::vector< char > text;
+  insns.reserve(_insns.size());
+  text.reserve(_text.size());
+  _insns_table.clear();
+  for (auto insn : _insns) {
+    if (overlaps(insn)) {
+      continue;
+    }
+    const char* t = this->text(insn);
+    insn.text = static_cast<::std::uint32_t >(text.size());
+    text.insert(text.end(), t, t + ::std::strlen(t) + 1);
+    insns.push_back(insn);
+    _insns_table.insert(insn.address,
+                        static_cast<::std::uint32_t >(insns.size() - 1));
+  }
+  _insns = ::std::move(insns);
+  _text = ::std::move(text);
+
+  ::std::vector< Block > blocks;
+  ::std::vector< Insn > blocks_insns;
+  _blocks_table.clear();
+  for (auto block : _blocks) {
+    if (overlaps(block)) {
+      continue;
+    }
+    auto first = static_cast<::std::uint32_t >(blocks_insns.size());
+    blocks_insns.insert(blocks_insns.end(),
+                        _blocks_insns.begin() + block.first,
+                        _blocks_insns.begin() + block.first + block.count);
+    block.first = first;
+    blocks.push_back(block);
+    _blocks_table.insert(block.address,
+                         static_cast<::std::uint32_t >(blocks.size() - 1));
+  }
+  _blocks = ::std::move(blocks);
+  _blocks_insns = ::std::move(blocks_insns);
+}
+
+void InsnCache::clear(void) {
+  _insns_table.clear();
+  _insns.clear();
+  _text.clear();
+  _blocks_table.clear();
+  _blocks.clear();
+  _blocks_insns.clear();
+  _low = UINT64_MAX;
+  _high = 0;
+}
+
+} // end namespace execution
+} // end namespace banal
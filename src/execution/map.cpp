@@ -6,6 +6,9 @@
 ///
 /// Contact: thomas at bailleux.me
 
+#include <sys/mman.h>
+
+#include <cstring>
 #include <iomanip>
 
 #include "banal/execution/map.hpp"
@@ -14,16 +17,79 @@
 namespace banal {
 namespace execution {
 
+namespace {
+
+/// \brief Set a bit
+///
+/// \param bits The bitmap
+/// \param i Index of the bit
+inline void set(::std::vector<::std::uint64_t >& bits, ::std::size_t i) {
+  bits[i / 64] |= 1ULL << (i % 64);
+}
+
+/// \brief Clear a bit
+///
+/// \param bits The bitmap
+/// \param i Index of the bit
+inline void clear(::std::vector<::std::uint64_t >& bits, ::std::size_t i) {
+  bits[i / 64] &= ~(1ULL << (i % 64));
+}
+
+/// \brief Shrink a bitmap
+///
+/// \param bits The bitmap
+/// \param n Number of bits to keep
+inline void truncate(::std::vector<::std::uint64_t >& bits, ::std::size_t n) {
+  bits.resize((n + 63) / 64);
+  if (n % 64) {
+    bits.back() &= (1ULL << (n % 64)) - 1;
+  }
+}
+
+} // end anonymous namespace
+
 Map::Map(::uc_engine* uc,
          ::std::uint64_t address,
          ::std::size_t size,
-         ::std::uint32_t perms)
+         ::std::uint32_t perms,
+         InsnCache* cache)
     : _uc(uc),
       _address(address),
       _size(size),
       _perms(perms),
       _good(false),
-      _mapped(false) {
+      _mapped(false),
+      _cache(cache),
+      _dirty((this->pages() + 63) / 64, 0),
+      _tracked(true),
+      _host(nullptr),
+      _resident(),
+      _source(nullptr),
+      _source_offset(0),
+      _source_size(0) {
+  this->map();
+}
+
+Map::Map(::uc_engine* uc,
+         ::std::uint64_t address,
+         ::std::size_t size,
+         ::std::uint32_t perms,
+         ::std::uint8_t* host,
+         InsnCache* cache)
+    : _uc(uc),
+      _address(address),
+      _size(size),
+      _perms(perms),
+      _good(false),
+      _mapped(false),
+      _cache(cache),
+      _dirty((this->pages() + 63) / 64, 0),
+      _tracked(true),
+      _host(host),
+      _resident((this->chunks() + 63) / 64, 0),
+      _source(nullptr),
+      _source_offset(0),
+      _source_size(0) {
   this->map();
 }
 
@@ -33,6 +99,13 @@ void Map::map(void) {
                           << ::std::endl;
     return;
   }
+  if (_host) {
+    // chunks are registered on their first access
+    ::banal::log::log("MAP: ", *this, " is reserved.");
+    _mapped = true;
+    _good = true;
+    return;
+  }
   if (auto e = ::uc_mem_map(_uc, _address, _size, _perms); e != ::UC_ERR_OK) {
     ::banal::log::cerr() << "Unable to map " << *this << ": "
                          << ::uc_strerror(e) << ::std::endl;
@@ -50,11 +123,30 @@ void Map::unmap(void) {
     ::banal::log::cwarn() << "Cannot unmap " << *this << ": not mapped."
                           << ::std::endl;
   }
-  if (auto e = ::uc_mem_unmap(_uc, _address, _size); e != ::UC_ERR_OK) {
+  ::uc_err e = ::UC_ERR_OK;
+  if (_host) {
+    // only registered chunks are known to unicorn
+    for (::std::size_t chunk = 0; chunk < this->chunks(); chunk++) {
+      if (!this->resident(chunk)) {
+        continue;
+      }
+      auto [offset, size] = this->chunk(chunk);
+      if (e = ::uc_mem_unmap(_uc, _address + offset, size); e != ::UC_ERR_OK) {
+        break;
+      }
+      clear(_resident, chunk);
+    }
+  } else {
+    e = ::uc_mem_unmap(_uc, _address, _size);
+  }
+  if (e != ::UC_ERR_OK) {
     ::banal::log::cerr() << "Unable to unmap " << *this << ": "
                          << ::uc_strerror(e) << ::std::endl;
     _good = false;
   } else {
+    if (_cache && (_perms & ::UC_PROT_EXEC)) {
+      _cache->invalidate(_address, _address + _size);
+    }
     ::banal::log::log("MAP::unmap called on ", this);
     _mapped = false;
     _good = true;
@@ -67,32 +159,300 @@ void Map::protect(::std::uint32_t perms) {
     ::banal::log::cwarn() << "Cannot protect " << *this << ": not mapped."
                           << ::std::endl;
   }
-  if (auto e = ::uc_mem_protect(_uc, _address, _size, perms);
-      e != ::UC_ERR_OK) {
+  ::uc_err e = ::UC_ERR_OK;
+  if (_host) {
+    // chunks registered later get the new permissions
+    for (::std::size_t chunk = 0; chunk < this->chunks(); chunk++) {
+      if (!this->resident(chunk)) {
+        continue;
+      }
+      auto [offset, size] = this->chunk(chunk);
+      if (e = ::uc_mem_protect(_uc, _address + offset, size, perms);
+          e != ::UC_ERR_OK) {
+        break;
+      }
+    }
+  } else {
+    e = ::uc_mem_protect(_uc, _address, _size, perms);
+  }
+  if (e != ::UC_ERR_OK) {
     ::banal::log::cerr() << "Unable to protect " << *this << ": "
                          << ::uc_strerror(e) << ::std::endl;
     _good = false;
   } else {
+    if (_cache && ((_perms | perms) & ::UC_PROT_EXEC)) {
+      // decoded instructions may not be valid anymore
+      _cache->invalidate(_address, _address + _size);
+    }
     _good = true;
     _perms = perms;
   }
 }
 
-Map::Map(Map&& m) {
-  _mapped = m._mapped;
-  _uc = m._uc;
-  _address = m._address;
-  _size = m._size;
-  _perms = m._perms;
-  _good = m._good;
+void Map::clean(void) {
+  ::std::fill(_dirty.begin(), _dirty.end(), 0);
+}
+
+void Map::track(bool tracked) {
+  if (tracked && !_tracked) {
+    ::std::fill(_dirty.begin(), _dirty.end(), ~0ULL);
+    truncate(_dirty, this->pages());
+  }
+  _tracked = tracked;
+}
+
+void Map::source(const ::std::uint8_t* data,
+                 ::std::size_t offset,
+                 ::std::size_t size) {
+  _source = data;
+  _source_offset = offset;
+  _source_size = size;
+}
+
+void Map::reset(::std::size_t offset, ::std::size_t size) {
+  if (!_host || offset >= _size) {
+    return;
+  }
+  size = ::std::min(size, _size - offset);
+  ::std::memset(_host + offset, 0, size);
+  auto begin = ::std::max(offset, _source_offset);
+  auto end = ::std::min(offset + size, _source_offset + _source_size);
+  if (_source && begin < end) {
+    ::std::memcpy(
+        _host + begin, _source + (begin - _source_offset), end - begin);
+  }
+}
+
+bool Map::fault(::std::uint64_t address, ::std::size_t size) {
+  if (!_host || !_mapped || address < _address ||
+      address - _address >= _size) {
+    return false;
+  }
+  auto offset = static_cast<::std::size_t >(address - _address);
+  auto first = this->chunk_of(offset);
+  auto stop = ::std::min(offset + ::std::max<::std::size_t >(size, 1), _size);
+  auto last = this->chunk_of(stop - 1);
+  for (auto chunk = first; chunk <= last; chunk++) {
+    if (this->resident(chunk)) {
+      continue;
+    }
+    auto [begin, length] = this->chunk(chunk);
+    auto end = begin + length;
+    if (!(_perms & ::UC_PROT_EXEC)) {
+      // registered neighbours are registered again with the chunk, as one
+      // unicorn region; code is not, it may be running
+      auto low = chunk;
+      while (low > 0 && this->resident(low - 1)) {
+        low--;
+      }
+      auto high = chunk;
+      while (high + 1 < this->chunks() && this->resident(high + 1)) {
+        high++;
+      }
+      auto left = this->chunk(low).first;
+      auto right = this->chunk(high).first + this->chunk(high).second;
+      if (left < begin &&
+          ::uc_mem_unmap(_uc, _address + left, begin - left) == ::UC_ERR_OK) {
+        begin = left;
+      }
+      if (right > end &&
+          ::uc_mem_unmap(_uc, _address + end, right - end) == ::UC_ERR_OK) {
+        end = right;
+      }
+    }
+    if (auto e = ::uc_mem_map_ptr(
+            _uc, _address + begin, end - begin, _perms, _host + begin);
+        e != ::UC_ERR_OK) {
+      ::banal::log::cerr() << "Unable to materialize 0x" << ::std::hex
+                           << _address + begin << " in " << *this << ": "
+                           << ::uc_strerror(e) << ::std::endl;
+      // neighbours may have been unmapped
+      for (auto c = this->chunk_of(begin); c <= this->chunk_of(end - 1); c++) {
+        clear(_resident, c);
+      }
+      return false;
+    }
+    for (auto c = this->chunk_of(begin); c <= this->chunk_of(end - 1); c++) {
+      set(_resident, c);
+    }
+  }
+  return true;
+}
 
-  m._mapped = false;
+Map::Map(Map& m, ::std::size_t offset)
+    : _uc(m._uc),
+      _address(m._address + offset),
+      _size(m._size - offset),
+      _perms(m._perms),
+      _good(m._good),
+      _mapped(m._mapped),
+      _cache(m._cache),
+      _dirty((this->pages() + 63) / 64, 0),
+      _tracked(m._tracked),
+      _host(m._host ? m._host + offset : nullptr),
+      _resident(m._host ? (this->chunks() + 63) / 64 : 0, 0),
+      _source(nullptr),
+      _source_offset(0),
+      _source_size(0) {
+  auto first_page = offset / PageSize;
+  for (::std::size_t page = 0; page < this->pages(); page++) {
+    if (m.dirty(first_page + page)) {
+      set(_dirty, page);
+    }
+  }
+  auto first_chunk = m.chunk_of(offset);
+  for (::std::size_t chunk = 0; _host && chunk < this->chunks(); chunk++) {
+    if (m.resident(first_chunk + chunk)) {
+      set(_resident, chunk);
+    }
+  }
+  if (!m._source || m._source_offset + m._source_size <= offset) {
+    return;
+  }
+  if (m._source_offset >= offset) {
+    _source = m._source;
+    _source_offset = m._source_offset - offset;
+    _source_size = m._source_size;
+  } else {
+    _source = m._source + (offset - m._source_offset);
+    _source_offset = 0;
+    _source_size = m._source_size - (offset - m._source_offset);
+  }
+}
+
+::std::unique_ptr< Map > Map::split(::std::size_t offset) {
+  if (offset == 0 || offset >= _size || offset % PageSize) {
+    ::banal::log::cerr() << "Cannot split " << *this << " at 0x" << ::std::hex
+                         << offset << '.' << ::std::endl;
+    return nullptr;
+  }
+  if (_mapped && !this->cut(offset)) {
+    return nullptr;
+  }
+  ::std::unique_ptr< Map > end(new Map(*this, offset));
+  if (_source && _source_offset >= offset) {
+    _source = nullptr;
+    _source_offset = 0;
+    _source_size = 0;
+  } else if (_source) {
+    _source_size = ::std::min(_source_size, offset - _source_offset);
+  }
+  _size = offset;
+  truncate(_dirty, this->pages());
+  if (_host) {
+    truncate(_resident, this->chunks());
+  }
+  return end;
+}
+
+bool Map::cut(::std::size_t offset) {
+  ::uc_err e = ::UC_ERR_OK;
+  if (!_host) {
+    // unicorn splits a region protected in part
+    e = ::uc_mem_protect(_uc, _address + offset, _size - offset, _perms);
+  } else if (auto chunk = this->chunk_of(offset);
+             this->resident(this->chunk_of(offset - 1)) &&
+             this->resident(chunk)) {
+    // the registered chunks around offset may be a single region, they are
+    // registered again as two
+    auto low = chunk;
+    while (low > 0 && this->resident(low - 1)) {
+      low--;
+    }
+    auto high = chunk;
+    while (high + 1 < this->chunks() && this->resident(high + 1)) {
+      high++;
+    }
+    auto left = this->chunk(low).first;
+    auto right = this->chunk(high).first + this->chunk(high).second;
+    if (e = ::uc_mem_unmap(_uc, _address + left, right - left);
+        e == ::UC_ERR_OK) {
+      e = ::uc_mem_map_ptr(
+          _uc, _address + left, offset - left, _perms, _host + left);
+      if (e == ::UC_ERR_OK) {
+        e = ::uc_mem_map_ptr(
+            _uc, _address + offset, right - offset, _perms, _host + offset);
+      }
+      if (e != ::UC_ERR_OK) {
+        // the content is still in host memory, chunks are registered again
+        // on their next access
+        for (auto c = low; c <= high; c++) {
+          clear(_resident, c);
+        }
+        ::uc_mem_unmap(_uc, _address + left, offset - left);
+      }
+    }
+  }
+  if (e != ::UC_ERR_OK) {
+    ::banal::log::cerr() << "Unable to split the unicorn region of " << *this
+                         << " at 0x" << ::std::hex << _address + offset << ": "
+                         << ::uc_strerror(e) << ::std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool Map::mergeable(const Map& next) const {
+  if (_uc != next._uc || _address + _size != next._address ||
+      _perms != next._perms || !_mapped || !next._mapped ||
+      _cache != next._cache || _tracked != next._tracked) {
+    return false;
+  }
+  if (_host ? next._host != _host + _size : next._host != nullptr) {
+    // host memory must be contiguous
+    return false;
+  }
+  return !_source || !next._source ||
+         (_source_offset + _source_size == _size && next._source_offset == 0 &&
+          _source + _source_size == next._source);
+}
+
+void Map::merge(Map& next) {
+  if (_host && next._address % ChunkSize) {
+    // the chunk on the boundary is registered on both sides, or neither
+    if (this->resident(this->chunks() - 1) && !next.resident(0)) {
+      next.fault(next._address, 1);
+    } else if (!this->resident(this->chunks() - 1) && next.resident(0)) {
+      this->fault(_address + _size - 1, 1);
+    }
+  }
+  auto first_page = this->pages();
+  auto first_chunk = this->chunk_of(_size);
+  if (!_source && next._source) {
+    _source = next._source;
+    _source_offset = _size + next._source_offset;
+    _source_size = next._source_size;
+  } else if (next._source) {
+    _source_size += next._source_size;
+  }
+  _size += next._size;
+  _dirty.resize((this->pages() + 63) / 64, 0);
+  for (::std::size_t page = 0; page < next.pages(); page++) {
+    if (next.dirty(page)) {
+      set(_dirty, first_page + page);
+    }
+  }
+  if (_host) {
+    _resident.resize((this->chunks() + 63) / 64, 0);
+    for (::std::size_t chunk = 0; chunk < next.chunks(); chunk++) {
+      if (next.resident(chunk)) {
+        set(_resident, first_chunk + chunk);
+      }
+    }
+  }
+  // the memory and the unicorn regions now belong to this map
+  next._host = nullptr;
+  next._mapped = false;
+  next._size = 0;
 }
 
 Map::~Map(void) {
   if (_mapped) {
     this->unmap();
   }
+  if (_host) {
+    ::munmap(_host, _size);
+  }
 }
 
 ::std::ostream& operator<<(::std::ostream& os,
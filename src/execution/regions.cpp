@@ -0,0 +1,134 @@
+///
+/// \file
+/// \brief Memory regions implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <iterator>
+
+#include "banal/execution/regions.hpp"
+#include "banal/util/log.hpp"
+
+namespace banal {
+namespace execution {
+
+Map* Regions::add(::std::unique_ptr< Map > map) {
+  if (!map || !map->good()) {
+    return nullptr;
+  }
+  auto address = map->address();
+  auto size = map->size();
+  const Map* other = this->find(address);
+  if (auto next = _maps.lower_bound(address);
+      !other && next != _maps.end() && next->first < address + size) {
+    other = next->second.get();
+  }
+  if (other) {
+    ::banal::log::cerr() << "Cannot add " << *map << ": it overlaps "
+                         << *other << '.' << ::std::endl;
+    return nullptr;
+  }
+  _maps.emplace(address, ::std::move(map));
+  this->coalesce(address, size);
+  return this->find(address);
+}
+
+Map* Regions::find(::std::uint64_t address) const {
+  auto it = _maps.upper_bound(address);
+  if (it == _maps.begin()) {
+    return nullptr;
+  }
+  it--;
+  if (address - it->first >= it->second->size()) {
+    return nullptr;
+  }
+  return it->second.get();
+}
+
+bool Regions::covered(::std::uint64_t address, ::std::size_t size) const {
+  if (address % PageSize || size % PageSize || size == 0) {
+    ::banal::log::cerr() << "The range 0x" << ::std::hex << address << "+0x"
+                         << size << " is not page aligned." << ::std::endl;
+    return false;
+  }
+  for (auto at = address; at < address + size;) {
+    const Map* m = this->find(at);
+    if (!m) {
+      ::banal::log::cerr() << "0x" << ::std::hex << at << " is not mapped."
+                           << ::std::endl;
+      return false;
+    }
+    at = m->address() + m->size();
+  }
+  return true;
+}
+
+bool Regions::split(::std::uint64_t address) {
+  Map* m = this->find(address);
+  if (!m || m->address() == address) {
+    return true;
+  }
+  auto end = m->split(static_cast<::std::size_t >(address - m->address()));
+  if (!end) {
+    return false;
+  }
+  _maps.emplace(address, ::std::move(end));
+  return true;
+}
+
+void Regions::coalesce(::std::uint64_t address, ::std::size_t size) {
+  auto it = _maps.upper_bound(address);
+  if (it != _maps.begin()) {
+    it--;
+  }
+  if (it != _maps.begin()) {
+    it--;
+  }
+  while (it != _maps.end() && it->first <= address + size) {
+    auto next = ::std::next(it);
+    if (next != _maps.end() && it->second->mergeable(*next->second)) {
+      it->second->merge(*next->second);
+      _maps.erase(next);
+      continue;
+    }
+    it = next;
+  }
+}
+
+bool Regions::protect(::std::uint64_t address,
+                      ::std::size_t size,
+                      ::std::uint32_t perms) {
+  if (!this->covered(address, size) || !this->split(address) ||
+      !this->split(address + size)) {
+    return false;
+  }
+  bool ok = true;
+  for (auto it = _maps.find(address);
+       it != _maps.end() && it->first < address + size;
+       it++) {
+    it->second->protect(perms);
+    ok = ok && it->second->good();
+  }
+  this->coalesce(address, size);
+  return ok;
+}
+
+bool Regions::unmap(::std::uint64_t address, ::std::size_t size) {
+  if (!this->covered(address, size) || !this->split(address) ||
+      !this->split(address + size)) {
+    return false;
+  }
+  bool ok = true;
+  auto it = _maps.find(address);
+  while (it != _maps.end() && it->first < address + size) {
+    it->second->unmap();
+    ok = ok && it->second->good();
+    it = _maps.erase(it);
+  }
+  return ok;
+}
+
+} // end namespace execution
+} // end namespace banal
@@ -0,0 +1,122 @@
+///
+/// \file
+/// \brief Stack shadow memory implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "banal/execution/shadow.hpp"
+#include "banal/util/log.hpp"
+
+namespace banal {
+namespace execution {
+
+namespace {
+
+/// \brief Number of shadow bytes checked at once
+constexpr ::std::size_t Lanes = 16;
+
+/// \brief Find the poisoned slots among Lanes shadow bytes
+///
+/// \param data The shadow bytes, Lanes of them are readable
+///
+/// \return A mask, bit i is set if byte i is not zero
+inline unsigned poisoned(const ::std::uint8_t* data) {
+#if defined(__SSE2__)
+  auto v = ::_mm_loadu_si128(reinterpret_cast< const ::__m128i* >(data));
+  auto zero = ::_mm_cmpeq_epi8(v, ::_mm_setzero_si128());
+  return ~static_cast< unsigned >(::_mm_movemask_epi8(zero)) & 0xffff;
+#else
+  unsigned mask = 0;
+  for (::std::size_t i = 0; i < Lanes; i++) {
+    mask |= static_cast< unsigned >(data[i] != Poison::None) << i;
+  }
+  return mask;
+#endif
+}
+
+} // end anonymous namespace
+
+Shadow::Shadow(uintarch_t address, ::std::size_t size)
+    : _address(address), _slots(size / Slot), _data(nullptr), _low(_slots) {
+  // the last check may read past the last slot
+  void* addr = ::mmap(nullptr,
+                      _slots + Lanes,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                      -1,
+                      0);
+  if (addr == MAP_FAILED) {
+    ::banal::log::cerr() << "Unable to reserve the shadow memory of the stack: "
+                         << ::std::strerror(errno) << ::std::endl;
+    return;
+  }
+  _data = static_cast<::std::uint8_t* >(addr);
+}
+
+Shadow::~Shadow(void) {
+  if (_data) {
+    ::munmap(_data, _slots + Lanes);
+  }
+}
+
+void Shadow::poison(uintarch_t address,
+                    ::std::size_t count,
+                    ::std::uint8_t kind) {
+  if (address < _address) {
+    return;
+  }
+  auto i = this->slot(address);
+  count = ::std::min(count, _slots - i);
+  ::std::memset(_data + i, kind, count);
+  if (count > 0) {
+    _low = ::std::min(_low, i);
+  }
+}
+
+void Shadow::retire(uintarch_t address) {
+  auto i = this->slot(address);
+  if (i > _low) {
+    ::std::memset(_data + _low, Poison::None, i - _low);
+    _low = i;
+  }
+}
+
+void Shadow::clear(void) {
+  this->retire(_address + static_cast< uintarch_t >(_slots * Slot));
+}
+
+::std::optional< uintarch_t > Shadow::check(uintarch_t address,
+                                            ::std::size_t size) const {
+  auto last = address + static_cast< uintarch_t >(size) - 1;
+  if (size == 0 || last < _address) {
+    return {};
+  }
+  auto first = ::std::max(this->slot(address), _low);
+  auto end = ::std::min(this->slot(last) + 1, _slots);
+  // writes below the frames, the common case, stop here
+  for (auto i = first; i < end; i += Lanes) {
+    auto mask = poisoned(_data + i);
+    if (end - i < Lanes) {
+      mask &= (1U << (end - i)) - 1;
+    }
+    if (mask) {
+      auto hit = i + static_cast<::std::size_t >(__builtin_ctz(mask));
+      return _address + static_cast< uintarch_t >(hit * Slot);
+    }
+  }
+  return {};
+}
+
+} // end namespace execution
+} // end namespace banal
@@ -0,0 +1,175 @@
+///
+/// \file
+/// \brief Emulation snapshot implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+
+#include "banal/execution/snapshot.hpp"
+#include "banal/util/log.hpp"
+
+namespace banal {
+namespace execution {
+
+namespace {
+
+/// \brief Offset of a chunk which has not been saved
+constexpr ::std::size_t Unsaved = static_cast<::std::size_t >(-1);
+
+} // end anonymous namespace
+
+Snapshot::Snapshot(::uc_engine* uc) : _uc(uc), _context(nullptr), _images() {}
+
+Snapshot::Snapshot(Snapshot&& s)
+    : _uc(s._uc), _context(s._context), _images(::std::move(s._images)) {
+  s._context = nullptr;
+}
+
+Snapshot::~Snapshot(void) {
+  if (_context) {
+    ::uc_free(_context);
+  }
+}
+
+bool Snapshot::save(Regions& maps) {
+  if (!_context) {
+    if (auto e = ::uc_context_alloc(_uc, &_context); e != ::UC_ERR_OK) {
+      ::banal::log::cerr() << "Unable to allocate a CPU context: "
+                           << ::uc_strerror(e) << ::std::endl;
+      _context = nullptr;
+      return false;
+    }
+  }
+  if (auto e = ::uc_context_save(_uc, _context); e != ::UC_ERR_OK) {
+    ::banal::log::cerr() << "Unable to save the CPU context: "
+                         << ::uc_strerror(e) << ::std::endl;
+    return false;
+  }
+
+  _images.clear();
+  for (auto it = maps.begin(); it != maps.end(); it++) {
+    auto& m = *it->second;
+    if (!m.mapped() || !(m.perms() & ::UC_PROT_WRITE)) {
+      // read only memory cannot change
+      continue;
+    }
+    if (m.lazy()) {
+      Image image{m.address(), {}, ::std::vector<::std::size_t >(m.chunks())};
+      for (::std::size_t chunk = 0; chunk < m.chunks(); chunk++) {
+        if (!m.resident(chunk)) {
+          image.chunks[chunk] = Unsaved;
+          continue;
+        }
+        auto [offset, size] = m.chunk(chunk);
+        const auto* host = m.host(m.address() + offset, size);
+        image.chunks[chunk] = image.data.size();
+        image.data.insert(image.data.end(), host, host + size);
+      }
+      _images.push_back(::std::move(image));
+      m.clean();
+      continue;
+    }
+    Image image{m.address(), ::std::vector<::std::uint8_t >(m.size()), {}};
+    if (auto e = ::uc_mem_read(_uc, m.address(), image.data.data(), m.size());
+        e != ::UC_ERR_OK) {
+      ::banal::log::cerr() << "Unable to save " << m << ": "
+                           << ::uc_strerror(e) << ::std::endl;
+      return false;
+    }
+    _images.push_back(::std::move(image));
+    m.clean();
+  }
+  ::banal::log::log("SNAPSHOT: ", ::std::dec, this->size(), " bytes saved.");
+  return true;
+}
+
+bool Snapshot::restore(Regions& maps) const {
+  if (!_context) {
+    ::banal::log::cerr() << "Unable to restore an empty snapshot."
+                         << ::std::endl;
+    return false;
+  }
+  if (auto e = ::uc_context_restore(_uc, _context); e != ::UC_ERR_OK) {
+    ::banal::log::cerr() << "Unable to restore the CPU context: "
+                         << ::uc_strerror(e) << ::std::endl;
+    return false;
+  }
+
+  auto image = _images.begin();
+  for (auto it = maps.begin(); it != maps.end(); it++) {
+    auto& m = *it->second;
+    if (image == _images.end()) {
+      break;
+    }
+    if (m.address() != image->address) {
+      continue;
+    }
+    auto pages = m.pages();
+    if (m.lazy()) {
+      // without write hooks, resident pages are compared to the image
+      for (::std::size_t page = 0; page < pages; page++) {
+        auto offset = page * PageSize;
+        auto size = ::std::min(PageSize, m.size() - offset);
+        auto chunk = m.chunk_of(offset);
+        auto saved = image->chunks[chunk];
+        auto* host = m.host(m.address() + offset, size);
+        const auto* data =
+            saved == Unsaved
+                ? nullptr
+                : image->data.data() + saved + (offset - m.chunk(chunk).first);
+        if (m.tracked() ? !m.dirty(page)
+                        : !m.resident(chunk) ||
+                              (data && ::std::memcmp(host, data, size) == 0)) {
+          continue;
+        }
+        if (data) {
+          ::std::memcpy(host, data, size);
+        } else {
+          // the chunk had its initial content
+          m.reset(offset, size);
+        }
+      }
+      m.clean();
+      image++;
+      continue;
+    }
+    // copy back runs of dirty pages
+    for (::std::size_t page = 0; page < pages; page++) {
+      if (!m.dirty(page)) {
+        continue;
+      }
+      auto first = page;
+      while (page + 1 < pages && m.dirty(page + 1)) {
+        page++;
+      }
+      auto offset = first * PageSize;
+      auto size = ::std::min((page + 1) * PageSize, m.size()) - offset;
+      if (auto e = ::uc_mem_write(
+              _uc, m.address() + offset, image->data.data() + offset, size);
+          e != ::UC_ERR_OK) {
+        ::banal::log::cerr() << "Unable to restore " << m << ": "
+                             << ::uc_strerror(e) << ::std::endl;
+        return false;
+      }
+    }
+    m.clean();
+    image++;
+  }
+  return true;
+}
+
+::std::size_t Snapshot::size(void) const {
+  ::std::size_t size = 0;
+  for (const auto& image : _images) {
+    size += image.data.size();
+  }
+  return size;
+}
+
+} // end namespace execution
+} // end namespace banal
@@ -6,42 +6,42 @@
 ///
 /// Contact: thomas at bailleux.me
 
+#include <cstring>
+
 #include "banal/execution/stack.hpp"
 #include "banal/util/log.hpp"
 
-#include "banal/conf.hpp"
-
 namespace banal {
 namespace execution {
 
 bool Stack::push(uintarch_t value) {
-  if (auto e = ::uc_mem_write(_uc,
-                              static_cast<::std::uint64_t >(_sp),
-                              reinterpret_cast< const void* >(&value),
-                              sizeof(value));
-      e != ::UC_ERR_OK) {
-    ::banal::log::cerr() << "Unable to push value \"" << value
-                         << "\" on stack at 0x" << _sp
-                         << " (write size: " << sizeof(value)
-                         << "): " << ::uc_strerror(e) << ::std::endl;
+  return this->push(&value, sizeof(value));
+}
+
+bool Stack::push(const void* data, ::std::size_t size) {
+  if (size > _data.size() - this->size()) {
+    ::banal::log::cerr() << "Unable to push " << ::std::dec << size
+                         << " bytes on stack at 0x" << ::std::hex << _sp
+                         << ": the stack is full." << ::std::endl;
     return false;
   }
-  _sp -= sizeof(value);
+  _sp -= static_cast< uintarch_t >(size);
+  if (size > 0) {
+    ::std::memcpy(_data.data() + (_data.size() - this->size()), data, size);
+  }
   return true;
 }
 
-bool Stack::pop(uintarch_t& value) {
-  if (auto e = ::uc_mem_read(_uc,
-                             static_cast<::std::uint64_t >(_sp),
-                             reinterpret_cast< void* >(&value),
-                             sizeof(value));
-      e != ::UC_ERR_OK) {
-    ::banal::log::cerr() << "Unable to read value on stack at 0x" << _sp
-                         << " (read size: " << sizeof(value)
-                         << "): " << ::uc_strerror(e) << ::std::endl;
+bool Stack::align(::std::size_t alignment) {
+  auto padding = static_cast<::std::size_t >(
+      _sp & static_cast< uintarch_t >(alignment - 1));
+  if (padding > _data.size() - this->size()) {
+    ::banal::log::cerr() << "Unable to align stack at 0x" << ::std::hex << _sp
+                         << ": the stack is full." << ::std::endl;
     return false;
   }
-  _sp += sizeof(value);
+  _sp -= static_cast< uintarch_t >(padding);
+  ::std::memset(_data.data() + (_data.size() - this->size()), 0, padding);
   return true;
 }
 
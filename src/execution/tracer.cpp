@@ -0,0 +1,150 @@
+///
+/// \file
+/// \brief Execution tracer implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+
+#include "banal/execution/tracer.hpp"
+#include "banal/util/log.hpp"
+
+namespace banal {
+namespace execution {
+
+namespace {
+
+/// \brief Size of the output buffer, written at once
+constexpr ::std::size_t BufferSize = 1 << 16;
+
+/// \brief Wait of the background thread when the ring is empty
+constexpr ::std::chrono::microseconds Idle(100);
+
+} // end anonymous namespace
+
+Tracer::Tracer(Architecture architecture,
+               ::std::ostream& out,
+               ::std::size_t capacity)
+    : _csh(0),
+      _insn(nullptr),
+      _out(out),
+      _ring(capacity),
+      _running(true),
+      _count(0),
+      _thread() {
+  // capstone handlers are not thread safe, the engine keeps its own
+  auto cs = get_cs_architecture(architecture);
+  if (auto e = ::cs_open(cs.first, cs.second, &_csh); e != ::CS_ERR_OK) {
+    ::banal::log::cerr() << "Unable to initialize the capstone engine of the "
+                            "tracer: "
+                         << ::cs_strerror(e) << ::std::endl;
+    _csh = 0;
+  } else {
+    _insn = ::cs_malloc(_csh);
+  }
+  _thread = ::std::thread([this] { this->drain(); });
+}
+
+Tracer::~Tracer(void) {
+  this->stop();
+  if (_insn) {
+    ::cs_free(_insn, 1);
+  }
+  if (_csh) {
+    ::cs_close(&_csh);
+  }
+}
+
+void Tracer::stop(void) {
+  if (_thread.joinable()) {
+    _running.store(false, ::std::memory_order_release);
+    _thread.join();
+    ::banal::log::log("TRACER: ", ::std::dec, _count, " records.");
+  }
+}
+
+void Tracer::format(const Record& record, ::std::string& buffer) {
+  char line[256];
+  int n = 0;
+  switch (record.kind) {
+    case RecordKind::Insn: {
+      const ::std::uint8_t* code = record.bytes;
+      ::std::size_t size = ::std::min< ::std::size_t >(record.size,
+                                                      sizeof(record.bytes));
+      ::std::uint64_t address = record.address;
+      if (_insn && ::cs_disasm_iter(_csh, &code, &size, &address, _insn)) {
+        n = ::std::snprintf(line,
+                            sizeof(line),
+                            CODE_YELLOW "[0x%" PRIx64 "]> " CODE_RESET
+                                        "%s\t%s\n",
+                            record.address,
+                            _insn->mnemonic,
+                            _insn->op_str);
+      } else {
+        n = ::std::snprintf(line,
+                            sizeof(line),
+                            CODE_YELLOW "[0x%" PRIx64 "]> " CODE_RESET "?\n",
+                            record.address);
+      }
+    } break;
+    case RecordKind::Block: {
+      n = ::std::snprintf(line,
+                          sizeof(line),
+                          "block 0x%" PRIx64 " (%" PRIu32 " bytes)\n",
+                          record.address,
+                          record.size);
+    } break;
+    case RecordKind::Write: {
+      n = ::std::snprintf(line,
+                          sizeof(line),
+                          "  write 0x%" PRIx64 " (%" PRIu32 " bytes)\n",
+                          record.address,
+                          record.size);
+    } break;
+  }
+  if (n > 0) {
+    buffer.append(line,
+                  ::std::min(static_cast<::std::size_t >(n), sizeof(line) - 1));
+  }
+}
+
+void Tracer::drain(void) {
+  ::std::string buffer;
+  buffer.reserve(BufferSize);
+  Record record;
+  for (;;) {
+    // read running first: records pushed before stop are then visible
+    bool running = _running.load(::std::memory_order_acquire);
+    bool empty = true;
+    while (_ring.pop(record)) {
+      empty = false;
+      _count++;
+      this->format(record, buffer);
+      if (buffer.size() >= BufferSize) {
+        _out.write(buffer.data(),
+                   static_cast<::std::streamsize >(buffer.size()));
+        buffer.clear();
+      }
+    }
+    if (!buffer.empty()) {
+      _out.write(buffer.data(),
+                 static_cast<::std::streamsize >(buffer.size()));
+      buffer.clear();
+    }
+    if (!running) {
+      break;
+    }
+    if (empty) {
+      ::std::this_thread::sleep_for(Idle);
+    }
+  }
+  _out.flush();
+}
+
+} // end namespace execution
+} // end namespace banal
@@ -6,72 +6,140 @@
 ///
 /// Contact: thomas at bailleux.me
 
+#include <algorithm>
+#include <cstring>
 #include <iomanip>
-
-#include <elfio/elfio.hpp>
+#include <type_traits>
 
 #include "banal/impl/binary/elf/binary.hpp"
 #include "banal/impl/binary/elf/component/section.hpp"
 #include "banal/impl/binary/elf/component/segment.hpp"
+#include "banal/impl/binary/elf/hash.hpp"
 #include "banal/util/log.hpp"
 
 #define PT_GNU_STACK 0x6474e551
 
+#ifndef NT_GNU_BUILD_ID
+#define NT_GNU_BUILD_ID 3
+#endif
+
 namespace banal {
 namespace binary {
 
+namespace {
+
+/// \brief Find the GNU build-id in notes
+///
+/// \param notes The notes
+/// \param size Size of the notes
+///
+/// \return The build-id, empty if absent
+::std::string_view find_build_id(const ::std::uint8_t* notes,
+                                 ::std::size_t size) {
+  // name and descriptor are padded to 4 bytes, in both classes
+  auto align = [](::std::uint64_t n) { return (n + 3) & ~::std::uint64_t(3); };
+  ::std::uint64_t off = 0;
+  while (notes != nullptr && size - off >= 12) {
+    ::std::uint32_t note[3];
+    ::std::memcpy(note, notes + off, sizeof(note));
+    auto name = off + 12;
+    auto desc = name + align(note[0]);
+    auto next = desc + align(note[1]);
+    if (next > size) {
+      break;
+    }
+    if (note[2] == NT_GNU_BUILD_ID && note[0] == 4 &&
+        ::std::memcmp(notes + name, "GNU", 4) == 0) {
+      return {reinterpret_cast< const char* >(notes + desc), note[1]};
+    }
+    off = next;
+  }
+  return {};
+}
+
+/// \brief Add a symbol read in place to a table
+///
+/// \param file The file
+/// \param sec The symbol section
+/// \param sym The symbol
+/// \param index Index of the symbol section
+/// \param table The table, with room for the symbol
+template < typename Class >
+void push(const ELFFile< Class >& file,
+          const typename Class::Shdr& sec,
+          const typename Class::Sym& sym,
+          ::std::uint16_t index,
+          component::SymbolTable& table) {
+  table.push(file.string(sec.sh_link, sym.st_name),
+             static_cast< uintarch_t >(sym.st_value),
+             static_cast<::std::size_t >(sym.st_size),
+             static_cast<::std::uint8_t >(ELF_ST_TYPE(sym.st_info)),
+             index);
+}
+
+} // end anonymous namespace
+
 ELFBinary::ELFBinary(const ::banal::Options& opt,
                      int fd,
                      void* addr,
                      ::std::size_t file_len)
     : Binary(opt, fd, addr, file_len),
-      _reader(),
+      _file(),
+      _machine(0),
       _segments(),
       _sections(),
+      _symbols(),
+      _segment_index(),
+      _indexed(),
+      _symbol_index(),
+      _label_index(),
+      _found_mutex(),
+      _found(),
       _entry(0),
+      _build_id(),
       _nx(true),
-      _pie(true) {
-  if (!_reader.load(_stream)) {
-    ::banal::log::cerr() << "Unable to parse the ELF." << ::std::endl;
-    return;
+      _pie(true) {}
+
+::std::optional<::banal::Architecture > ELFBinary::machine(void) const {
+  switch (_machine) {
+    case 0x03:
+      return ::banal::Architecture::X86;
+    case 0x28:
+      return ::banal::Architecture::ARM;
+    case 0x3E:
+      return ::banal::Architecture::X86_64;
+    case 0xB7:
+      return ::banal::Architecture::AArch64;
+    default:
+      return ::std::nullopt;
   }
-  _entry = static_cast< uintarch_t >(_reader.get_entry());
-  _good = true;
 }
 
-::banal::Architecture ELFBinary::architecture(void) const {
-  auto machine = _reader.get_machine();
-  Architecture arch;
-  switch (machine) {
-    case 0x03: {
-      arch = ::banal::Architecture::X86;
-    } break;
-    case 0x28: {
-      arch = ::banal::Architecture::ARM;
-    } break;
-    case 0x3E: {
-      arch = ::banal::Architecture::X86_64;
-    } break;
-    case 0xB7: {
-      arch = ::banal::Architecture::AArch64;
-    } break;
-    default: {
-      ::banal::log::cerr() << "Architecture type " << _reader.get_machine()
-                           << " is not supported yet." << ::std::endl;
-      ::banal::log::unreachable("Not supported yet");
-    }
+bool ELFBinary::check_architecture(void) const {
+  auto arch = this->machine();
+  if (!arch) {
+    ::banal::log::cerr() << "Architecture type " << _machine
+                         << " is not supported yet." << ::std::endl;
+    return false;
   }
-  if (!::banal::is_architecture_size_supported(arch)) {
+  if (!::banal::is_architecture_size_supported(*arch)) {
     ::banal::log::cerr()
-        << "This architecture (" << arch
+        << "This architecture (" << *arch
         << ") size is not supported by this version of banal." << ::std::endl
         << "Please recompile banal with the appropriate architecture size "
            "(using cmake -DARCH_SIZE=(32|64))"
         << ::std::endl;
-    ::banal::log::unreachable("Reachable");
-  } else {
-    return arch;
+    return false;
   }
+  return true;
+}
+
+::banal::Architecture ELFBinary::architecture(void) const {
+  // checked by parse
+  if (auto arch = this->machine(); arch && this->check_architecture()) {
+    return *arch;
+  }
+  ::banal::log::unreachable("Not supported yet");
 }
 
 uintarch_t ELFBinary::entry(void) const {
@@ -85,15 +153,51 @@ void ELFBinary::set_entry(uintarch_t e) {
 bool ELFBinary::parse(void) {
   ::banal::log::log("Start ELF parsing");
 
-  _pie = _reader.get_type() == ET_DYN;
+  const auto* ident = this->begin();
+  if (this->size() < EI_NIDENT) {
+    ::banal::log::cerr() << "Unable to parse the ELF." << ::std::endl;
+    return false;
+  }
+  // headers are read in place, they have to be in the host byte order
+  if (ident[EI_DATA] != ELFDATA2LSB) {
+    ::banal::log::cerr() << "Big endian ELF are not supported yet."
+                         << ::std::endl;
+    return false;
+  }
+  switch (ident[EI_CLASS]) {
+    case ELFCLASS32:
+      return this->parse(
+          _file.emplace< ELFFile< ELF32 > >(this->begin(), this->size()));
+    case ELFCLASS64:
+      return this->parse(
+          _file.emplace< ELFFile< ELF64 > >(this->begin(), this->size()));
+    default:
+      ::banal::log::cerr() << "Unknown ELF class." << ::std::endl;
+      return false;
+  }
+}
+
+template < typename Class >
+bool ELFBinary::parse(ELFFile< Class >& file) {
+  if (!file.parse()) {
+    ::banal::log::cerr() << "Unable to parse the ELF." << ::std::endl;
+    return false;
+  }
+  const auto& header = file.header();
+  _machine = header.e_machine;
+  // reject unsupported architectures here, architecture() would abort
+  if (!this->check_architecture()) {
+    return false;
+  }
+  _entry = static_cast< uintarch_t >(header.e_entry);
+  _pie = header.e_type == ET_DYN;
 
-  auto seg_num = _reader.segments.size();
+  auto seg_num = file.segments();
   ::banal::log::log("Segment number: ", seg_num);
-  ::std::vector<::std::uint16_t > known_sections;
-  known_sections.reserve(_reader.sections.size());
-  for (::std::uint32_t i = 0; i < seg_num; i++) {
-    const auto* seg = _reader.segments[i];
-    _segments.emplace_back(::std::make_unique< component::ELFSegment >(i, seg));
+  _segments.reserve(seg_num);
+  for (::std::size_t i = 0; i < seg_num; i++) {
+    _segments.emplace_back(::std::make_unique< component::ELFSegment< Class > >(
+        static_cast<::std::uint16_t >(i), file, file.segment(i)));
     auto& segg = _segments.back();
     // check NX
     if (segg->type() == PT_GNU_STACK && (segg->flags() & PF_X)) {
@@ -101,23 +205,165 @@ bool ELFBinary::parse(void) {
     }
   }
 
-  auto sec_num = _reader.sections.size();
+  auto sec_num = file.sections();
   ::banal::log::log("Section number: ", sec_num);
-  for (::std::uint32_t i = 0; i < sec_num; i++) {
-    auto* sec = _reader.sections[i];
-    _sections.emplace_back(
-        ::std::make_unique< component::ELFSection >(_reader, i, sec));
-    auto& secc = *_sections.back();
-    for (auto it = secc.symbols_cbegin(); it != secc.symbols_cend(); it++) {
-      auto& sym = *it;
-      ::std::pair< uintarch_t, const component::Symbol& > value{sym.value(),
-                                                                sym};
-      _symbols.insert(value);
+  _sections.reserve(sec_num);
+  for (::std::size_t i = 0; i < sec_num; i++) {
+    _sections.emplace_back(::std::make_unique< component::ELFSection< Class > >(
+        file, static_cast<::std::uint16_t >(i), file.section(i)));
+    // symbols are decoded on first use
+    auto type = file.section(i).sh_type;
+    if (type == SHT_NOTE && _build_id.empty()) {
+      const auto& sec = file.section(i);
+      _build_id = find_build_id(file.data(sec.sh_offset, sec.sh_size),
+                                static_cast<::std::size_t >(sec.sh_size));
+    }
+    if (type == SHT_SYMTAB || type == SHT_DYNSYM) {
+      _symbols.push_back(::std::make_unique< SymbolSection >());
+      _symbols.back()->index = static_cast<::std::uint16_t >(i);
     }
   }
+  for (::std::size_t i = 0; i < sec_num; i++) {
+    const auto& sec = file.section(i);
+    if (sec.sh_type != SHT_GNU_HASH && sec.sh_type != SHT_HASH) {
+      continue;
+    }
+    for (auto& symbols : _symbols) {
+      if (symbols->index == sec.sh_link) {
+        auto& hash = sec.sh_type == SHT_GNU_HASH ? symbols->gnu_hash
+                                                 : symbols->hash;
+        hash = static_cast<::std::uint16_t >(i);
+      }
+    }
+  }
+
+  ::std::vector< util::IntervalIndex< uintarch_t >::Interval > segments;
+  for (const auto& seg : _segments) {
+    if (seg->type() == PT_LOAD) {
+      segments.push_back({seg->virtual_address(),
+                          seg->virtual_address() + seg->memory_size(),
+                          static_cast< uintarch_t >(seg->offset())});
+    }
+  }
+  _segment_index.build(::std::move(segments));
+  _good = true;
   return true;
 }
 
+const component::SymbolTable& ELFBinary::decode(SymbolSection& symbols) const {
+  ::std::call_once(symbols.decoded, [this, &symbols] {
+    ::std::visit(
+        [this, &symbols](const auto& file) {
+          if constexpr (!::std::is_same_v<::std::decay_t< decltype(file) >,
+                                          ::std::monostate >) {
+            this->decode(file, symbols);
+          }
+        },
+        _file);
+  });
+  return symbols.table;
+}
+
+template < typename Class >
+void ELFBinary::decode(const ELFFile< Class >& file,
+                       SymbolSection& symbols) const {
+  using Sym = typename Class::Sym;
+  const auto& sec = file.section(symbols.index);
+  auto len_symbols = static_cast<::std::size_t >(sec.sh_size / sizeof(Sym));
+  const auto* syms = file.template at< Sym >(sec.sh_offset, len_symbols);
+  if (sec.sh_entsize != sizeof(Sym) || syms == nullptr) {
+    ::banal::log::cerr() << "Unable to retrieve the symbols of section `"
+                         << file.section_name(sec) << "`." << ::std::endl;
+    return;
+  }
+  ::banal::log::log("Symbols number: ",
+                    len_symbols,
+                    " for section `",
+                    file.section_name(sec),
+                    '`');
+  symbols.table.reserve(len_symbols);
+  for (::std::size_t j = 0; j < len_symbols; j++) {
+    push(file, sec, syms[j], symbols.index, symbols.table);
+  }
+}
+
+::std::optional<::std::size_t > ELFBinary::lookup(
+    SymbolSection& symbols, ::std::string_view name) const {
+  return ::std::visit(
+      [&symbols, name](const auto& file) -> ::std::optional<::std::size_t > {
+        if constexpr (::std::is_same_v<::std::decay_t< decltype(file) >,
+                                       ::std::monostate >) {
+          return ::std::nullopt;
+        } else {
+          const auto& symtab = file.section(symbols.index);
+          if (symbols.gnu_hash != 0) {
+            return gnu_hash_lookup(
+                file, file.section(symbols.gnu_hash), symtab, name);
+          }
+          if (symbols.hash != 0) {
+            return sysv_hash_lookup(
+                file, file.section(symbols.hash), symtab, name);
+          }
+          ::std::call_once(symbols.named, [&file, &symtab, &symbols] {
+            symbols.names = name_index(file, symtab);
+          });
+          return name_index_lookup(file, symtab, symbols.names, name);
+        }
+      },
+      _file);
+}
+
+::std::optional< component::Symbol > ELFBinary::symbol(
+    const SymbolSection& symbols, ::std::size_t index) const {
+  auto key = (static_cast<::std::uint64_t >(symbols.index) << 32) | index;
+  ::std::lock_guard< ::std::mutex > lock(_found_mutex);
+  auto& table = _found[key];
+  if (!table) {
+    table = ::std::make_unique< component::SymbolTable >();
+    table->reserve(1);
+    ::std::visit(
+        [&symbols, index, &table](const auto& file) {
+          if constexpr (!::std::is_same_v<::std::decay_t< decltype(file) >,
+                                          ::std::monostate >) {
+            using Sym = typename ::std::decay_t< decltype(file) >::Sym;
+            const auto& sec = file.section(symbols.index);
+            const auto* syms =
+                file.template at< Sym >(sec.sh_offset, index + 1);
+            if (index < sec.sh_size / sizeof(Sym) && syms != nullptr) {
+              push(file, sec, syms[index], symbols.index, *table);
+            }
+          }
+        },
+        _file);
+  }
+  if (table->size() == 0) {
+    return ::std::nullopt;
+  }
+  return (*table)[0];
+}
+
+void ELFBinary::index_addresses(void) const {
+  ::std::vector< util::IntervalIndex< component::Symbol >::Interval > symbols;
+  ::std::vector< util::IntervalIndex< component::Symbol >::Interval > labels;
+  for (const auto& section : _symbols) {
+    const auto& table = this->decode(*section);
+    for (::std::size_t i = 0; i < table.size(); i++) {
+      auto value = table.value(i);
+      if (value == 0) {
+        continue;
+      }
+      if (auto size = table.size(i); size != 0) {
+        symbols.push_back({value, value + size, table[i]});
+      } else {
+        labels.push_back({value, value + 1, table[i]});
+      }
+    }
+  }
+  _symbol_index.build(::std::move(symbols));
+  _label_index.build(::std::move(labels));
+  ::banal::log::log("Indexed ", _symbol_index.size(), " symbol(s).");
+}
+
 ::std::vector<::std::unique_ptr< component::Segment > >::const_iterator
 ELFBinary::segments_cbegin(void) const {
   return _segments.cbegin();
@@ -138,13 +384,46 @@ ELFBinary::sections_cend(void) const {
   return _sections.cend();
 }
 
-const ::std::unordered_map< uintarch_t, const component::Symbol& >& ELFBinary::
-    symbols(void) const {
-  return _symbols;
+::std::optional< component::Symbol > ELFBinary::find_symbol(
+    ::std::string_view name) const {
+  // symbols are found and read in the raw sections, nothing is decoded
+  for (const auto& symbols : _symbols) {
+    if (auto index = this->lookup(*symbols, name)) {
+      if (auto symbol = this->symbol(*symbols, *index); symbol) {
+        return symbol;
+      }
+    }
+  }
+  return ::std::nullopt;
 }
 
 ELFBinary::~ELFBinary(void) {}
 
+::std::vector< component::Symbol > ELFBinary::functions(void) const {
+  ::std::vector< component::Symbol > functions;
+  for (const auto& section : _symbols) {
+    const auto& table = this->decode(*section);
+    for (auto symbol : table) {
+      if (symbol.type() == STT_FUNC && symbol.value() != 0 &&
+          symbol.size() != 0) {
+        functions.push_back(symbol);
+      }
+    }
+  }
+  // a function may be in both .symtab and .dynsym, keep one
+  ::std::stable_sort(
+      functions.begin(), functions.end(), [](const auto& a, const auto& b) {
+        return a.value() < b.value();
+      });
+  functions.erase(::std::unique(functions.begin(),
+                                functions.end(),
+                                [](const auto& a, const auto& b) {
+                                  return a.value() == b.value();
+                                }),
+                  functions.end());
+  return functions;
+}
+
 void ELFBinary::dump(void) const {
   ::banal::log::cinfo() << ::std::dec << _segments.size()
                         << " segment(s): " << ::std::endl;
@@ -198,18 +477,20 @@ void ELFBinary::dump(void) const {
 }
 
 ::std::optional< uintarch_t > ELFBinary::get_address(uintarch_t address) const {
-  for (auto& seg : _segments) {
-    if (auto real = seg->contains(address)) {
-      return *real;
-    }
+  if (const auto* seg = _segment_index.find(address)) {
+    return static_cast< uintarch_t >(seg->value + (address - seg->begin));
   }
   return ::std::nullopt;
 }
 
-::std::optional<::std::reference_wrapper< const component::Symbol > >
-ELFBinary::get_symbol(uintarch_t address) const {
-  if (const auto it = _symbols.find(address); it != _symbols.end()) {
-    return it->second;
+::std::optional< component::Symbol > ELFBinary::get_symbol(
+    uintarch_t address) const {
+  ::std::call_once(_indexed, [this] { this->index_addresses(); });
+  if (const auto* sym = _symbol_index.find(address)) {
+    return sym->value;
+  }
+  if (const auto* label = _label_index.find(address)) {
+    return label->value;
   }
   return ::std::nullopt;
 }
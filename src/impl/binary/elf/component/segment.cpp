@@ -12,45 +12,60 @@ namespace banal {
 namespace binary {
 namespace component {
 
-ELFSegment::ELFSegment(::std::uint16_t index, const ::ELFIO::segment* seg)
-    : Segment(index), _seg(*seg) {}
+template < typename Class >
+ELFSegment< Class >::ELFSegment(::std::uint16_t index,
+                                const ELFFile< Class >& file,
+                                const typename Class::Phdr& seg)
+    : Segment(index), _file(file), _seg(seg) {}
 
-::std::size_t ELFSegment::offset(void) const {
-  return _seg.get_offset();
+template < typename Class >
+::std::size_t ELFSegment< Class >::offset(void) const {
+  return static_cast<::std::size_t >(_seg.p_offset);
 }
 
-::std::uint32_t ELFSegment::type(void) const {
-  return _seg.get_type();
+template < typename Class >
+::std::uint32_t ELFSegment< Class >::type(void) const {
+  return _seg.p_type;
 }
 
-::std::uint32_t ELFSegment::flags(void) const {
-  return _seg.get_flags();
+template < typename Class >
+::std::uint32_t ELFSegment< Class >::flags(void) const {
+  return _seg.p_flags;
 }
 
-uintarch_t ELFSegment::align(void) const {
-  return _seg.get_align();
+template < typename Class >
+uintarch_t ELFSegment< Class >::align(void) const {
+  return static_cast< uintarch_t >(_seg.p_align);
 }
 
-uintarch_t ELFSegment::virtual_address(void) const {
-  return _seg.get_virtual_address();
+template < typename Class >
+uintarch_t ELFSegment< Class >::virtual_address(void) const {
+  return static_cast< uintarch_t >(_seg.p_vaddr);
 }
 
-uintarch_t ELFSegment::physical_address(void) const {
-  return _seg.get_physical_address();
+template < typename Class >
+uintarch_t ELFSegment< Class >::physical_address(void) const {
+  return static_cast< uintarch_t >(_seg.p_paddr);
 }
 
-::std::size_t ELFSegment::file_size(void) const {
-  return _seg.get_file_size();
+template < typename Class >
+::std::size_t ELFSegment< Class >::file_size(void) const {
+  return static_cast<::std::size_t >(_seg.p_filesz);
 }
 
-::std::size_t ELFSegment::memory_size(void) const {
-  return _seg.get_memory_size();
+template < typename Class >
+::std::size_t ELFSegment< Class >::memory_size(void) const {
+  return static_cast<::std::size_t >(_seg.p_memsz);
 }
 
-const ::std::uint8_t* ELFSegment::data(void) const {
-  return reinterpret_cast< const ::std::uint8_t* >(_seg.get_data());
+template < typename Class >
+const ::std::uint8_t* ELFSegment< Class >::data(void) const {
+  return _file.data(_seg.p_offset, _seg.p_filesz);
 }
 
+template class ELFSegment< ELF32 >;
+template class ELFSegment< ELF64 >;
+
 } // end namespace component
 } // end namespace binary
 } // end namespace banal
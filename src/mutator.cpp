@@ -0,0 +1,119 @@
+///
+/// \file
+/// \brief Input mutator implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "banal/mutator.hpp"
+
+namespace banal {
+
+namespace {
+
+/// \brief Maximum size of a mutated buffer
+constexpr ::std::size_t MaxSize = 4096;
+
+/// \brief Maximum number of arguments, including the program name
+constexpr ::std::size_t MaxArgs = 8;
+
+/// \brief Maximum number of mutations applied at once
+constexpr ::std::size_t MaxStack = 4;
+
+/// \brief Bytes which often reach corner cases
+constexpr ::std::uint8_t Interesting[] = {
+    0x00, 0x01, 0x7f, 0x80, 0xff, '%', '\n', ' ', '/', 'A'};
+
+} // end anonymous namespace
+
+Mutator::Mutator(::std::uint64_t seed) : _state(seed ? seed : 1) {}
+
+::std::uint64_t Mutator::next(void) {
+  _state ^= _state >> 12;
+  _state ^= _state << 25;
+  _state ^= _state >> 27;
+  return _state * 0x2545f4914f6cdd1dULL;
+}
+
+::std::size_t Mutator::below(::std::size_t n) {
+  return static_cast<::std::size_t >(next() % n);
+}
+
+template < typename T >
+void Mutator::mutate(T& buffer, bool text) {
+  using value_type = typename T::value_type;
+  auto size = buffer.size();
+  switch (size ? this->below(6) : 2) {
+    case 0: {
+      // flip a bit
+      auto& b = buffer[this->below(size)];
+      b = static_cast< value_type >(b ^ (1 << this->below(8)));
+    } break;
+    case 1: {
+      // random byte
+      buffer[this->below(size)] = static_cast< value_type >(this->next());
+    } break;
+    case 2: {
+      // insert a run of a byte
+      auto len = 1 + this->below(1 << (1 + this->below(9)));
+      len = ::std::min(len, MaxSize - ::std::min(size, MaxSize));
+      auto byte = Interesting[this->below(sizeof(Interesting))];
+      buffer.insert(buffer.begin() +
+                        static_cast< long >(this->below(size + 1)),
+                    len,
+                    static_cast< value_type >(byte));
+    } break;
+    case 3: {
+      // erase a chunk
+      auto at = this->below(size);
+      auto len = 1 + this->below(size - at);
+      buffer.erase(buffer.begin() + static_cast< long >(at),
+                   buffer.begin() + static_cast< long >(at + len));
+    } break;
+    case 4: {
+      // duplicate a chunk at the end
+      auto at = this->below(size);
+      auto len = 1 + this->below(size - at);
+      len = ::std::min(len, MaxSize - ::std::min(size, MaxSize));
+      for (::std::size_t i = 0; i < len; i++) {
+        buffer.push_back(buffer[at + i]);
+      }
+    } break;
+    case 5: {
+      // interesting byte
+      buffer[this->below(size)] = static_cast< value_type >(
+          Interesting[this->below(sizeof(Interesting))]);
+    } break;
+  }
+  if (text) {
+    // arguments are C strings
+    ::std::replace(buffer.begin(),
+                   buffer.end(),
+                   static_cast< value_type >(0),
+                   static_cast< value_type >('A'));
+  }
+}
+
+void Mutator::mutate(execution::Input& input) {
+  auto count = 1 + this->below(MaxStack);
+  for (::std::size_t i = 0; i < count; i++) {
+    // 0 is the standard input, then the arguments, then a new argument
+    auto slots = input.args.size() + (input.args.size() < MaxArgs ? 1 : 0);
+    auto target = this->below(::std::max< ::std::size_t >(slots, 1));
+    if (target == 0) {
+      this->mutate(input.data, false);
+    } else if (target < input.args.size()) {
+      this->mutate(input.args[target], true);
+    } else {
+      input.args.emplace_back();
+      this->mutate(input.args.back(), true);
+    }
+  }
+}
+
+} // end namespace banal
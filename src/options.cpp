@@ -12,6 +12,7 @@
 #include <llvm/Support/CommandLine.h>
 
 #include "banal/options.hpp"
+#include "banal/util/log.hpp"
 
 namespace banal {
 
@@ -21,11 +22,11 @@ namespace banal {
 /// \brief Main category
 static ::llvm::cl::OptionCategory MainCategory("Main Options");
 
-/// \brief The filename to analyze
+/// \brief The filename to analyze, required out of batch mode
 static ::llvm::cl::opt<::std::string > InputFilename(
     ::llvm::cl::Positional,
     ::llvm::cl::desc("<binary file>"),
-    ::llvm::cl::Required,
+    ::llvm::cl::Optional,
     ::llvm::cl::value_desc("filename"),
     ::llvm::cl::cat(MainCategory));
 
@@ -40,6 +41,170 @@ static ::llvm::cl::list<::std::string > Argv(
 /// \brief Options category
 static ::llvm::cl::OptionCategory AnalysisCategory("Analysis Options");
 
+/// \brief Instrumentation granularity
+static ::llvm::cl::opt< Instrumentation > InstrumentationMode(
+    "instrumentation",
+    ::llvm::cl::desc("Instrumentation granularity"),
+    ::llvm::cl::values(clEnumValN(Instrumentation::Instruction,
+                                  "insn",
+                                  "Hook every instruction (trace)"),
+                       clEnumValN(Instrumentation::Block,
+                                  "block",
+                                  "Hook every basic block (fast)")),
+    ::llvm::cl::init(Instrumentation::Block),
+    ::llvm::cl::cat(AnalysisCategory));
+
+/// \brief File served on the standard input
+static ::llvm::cl::opt<::std::string > InputFile(
+    "input",
+    ::llvm::cl::desc("File served on the standard input of the program"),
+    ::llvm::cl::value_desc("filename"),
+    ::llvm::cl::cat(AnalysisCategory));
+
+/// \brief Maximum number of blocks per run
+static ::llvm::cl::opt<::std::size_t > Budget(
+    "budget",
+    ::llvm::cl::desc("Maximum number of basic blocks per run (0: no limit)"),
+    ::llvm::cl::init(1000000),
+    ::llvm::cl::cat(AnalysisCategory));
+
+/// \brief Compact trace of the executed blocks
+static ::llvm::cl::opt<::std::string > TraceFile(
+    "trace-file",
+    ::llvm::cl::desc("Record the executed blocks into a compact trace, "
+                     "printed by banal-trace"),
+    ::llvm::cl::value_desc("filename"),
+    ::llvm::cl::cat(AnalysisCategory));
+
+/// \brief Check stack writes against a shadow memory
+static ::llvm::cl::opt< bool > ShadowStack(
+    "shadow",
+    ::llvm::cl::desc("Stop at the first write over a return address or a "
+                     "saved register (hooks every stack write)"),
+    ::llvm::cl::init(false),
+    ::llvm::cl::cat(AnalysisCategory));
+
+/// \brief Check stack writes against the bounds of the frames
+static ::llvm::cl::opt< bool > FrameBounds(
+    "frames",
+    ::llvm::cl::desc("Stop at the first write running past a frame into the "
+                     "frame of its caller (hooks every stack write)"),
+    ::llvm::cl::init(false),
+    ::llvm::cl::cat(AnalysisCategory));
+
+/// @}
+/// \name Exploration options
+/// @{
+
+/// \brief Exploration category
+static ::llvm::cl::OptionCategory ExplorationCategory("Exploration Options");
+
+/// \brief Number of mutated inputs
+static ::llvm::cl::opt<::std::size_t > Iterations(
+    "iterations",
+    ::llvm::cl::desc("Number of mutated inputs to run from the snapshot at "
+                     "main (0: run the program once)"),
+    ::llvm::cl::init(0),
+    ::llvm::cl::cat(ExplorationCategory));
+
+/// \brief Seed of the mutator
+static ::llvm::cl::opt<::std::uint64_t > Seed(
+    "seed",
+    ::llvm::cl::desc("Seed of the input mutator"),
+    ::llvm::cl::init(1),
+    ::llvm::cl::cat(ExplorationCategory));
+
+/// \brief Number of workers
+static ::llvm::cl::opt<::std::size_t > Jobs(
+    "jobs",
+    ::llvm::cl::desc("Number of exploration workers (0: one per core)"),
+    ::llvm::cl::init(1),
+    ::llvm::cl::cat(ExplorationCategory));
+
+/// \brief Priority of the pending jobs
+static ::llvm::cl::opt< Priority > JobPriority(
+    "priority",
+    ::llvm::cl::desc("Priority of the pending exploration jobs"),
+    ::llvm::cl::values(
+        clEnumValN(Priority::Depth, "depth", "Most mutated inputs first"),
+        clEnumValN(Priority::Coverage,
+                   "coverage",
+                   "Inputs derived from new coverage first"),
+        clEnumValN(Priority::Danger,
+                   "danger",
+                   "Inputs derived from dangerous calls (strcpy, ...) first")),
+    ::llvm::cl::init(Priority::Coverage),
+    ::llvm::cl::cat(ExplorationCategory));
+
+/// @}
+/// \name Batch options
+/// @{
+
+/// \brief Batch category
+static ::llvm::cl::OptionCategory BatchCategory("Batch Options");
+
+/// \brief Binaries to analyze in batch
+static ::llvm::cl::opt<::std::string > BatchList(
+    "batch",
+    ::llvm::cl::desc("Analyze many binaries: a directory, walked "
+                     "recursively, or a file listing one path per line "
+                     "('-': standard input)"),
+    ::llvm::cl::value_desc("path"),
+    ::llvm::cl::cat(BatchCategory));
+
+/// \brief Number of batch workers opening and mapping binaries
+static ::llvm::cl::opt<::std::size_t > BatchIOJobs(
+    "batch-io-jobs",
+    ::llvm::cl::desc("Number of binaries opened and read ahead at once"),
+    ::llvm::cl::init(2),
+    ::llvm::cl::cat(BatchCategory));
+
+/// \brief Number of batch workers parsing binaries
+static ::llvm::cl::opt<::std::size_t > BatchParseJobs(
+    "batch-parse-jobs",
+    ::llvm::cl::desc("Number of binaries parsed at once"),
+    ::llvm::cl::init(1),
+    ::llvm::cl::cat(BatchCategory));
+
+/// \brief Number of batch workers running the static pre-pass
+static ::llvm::cl::opt<::std::size_t > BatchStaticJobs(
+    "batch-static-jobs",
+    ::llvm::cl::desc("Number of binaries statically checked at once"),
+    ::llvm::cl::init(1),
+    ::llvm::cl::cat(BatchCategory));
+
+/// \brief Number of batch workers emulating binaries
+static ::llvm::cl::opt<::std::size_t > BatchJobs(
+    "batch-jobs",
+    ::llvm::cl::desc("Number of binaries emulated at once (0: one per core)"),
+    ::llvm::cl::init(0),
+    ::llvm::cl::cat(BatchCategory));
+
+/// \brief Number of binaries waiting between two batch stages
+static ::llvm::cl::opt<::std::size_t > BatchDepth(
+    "batch-depth",
+    ::llvm::cl::desc("Number of binaries waiting between two stages, it "
+                     "bounds the number of mapped binaries"),
+    ::llvm::cl::init(16),
+    ::llvm::cl::cat(BatchCategory));
+
+/// \brief Results of the batch
+static ::llvm::cl::opt<::std::string > BatchResults(
+    "results",
+    ::llvm::cl::desc("File receiving one JSON record per binary "
+                     "('-': standard output)"),
+    ::llvm::cl::value_desc("filename"),
+    ::llvm::cl::init("-"),
+    ::llvm::cl::cat(BatchCategory));
+
+/// \brief Analysis cache
+static ::llvm::cl::opt<::std::string > CacheFile(
+    "cache",
+    ::llvm::cl::desc("Cache of the results, shared by concurrent batches: "
+                     "unchanged binaries are skipped"),
+    ::llvm::cl::value_desc("filename"),
+    ::llvm::cl::cat(BatchCategory));
+
 /// @}
 /// \name Debug options
 /// @{
@@ -58,14 +223,54 @@ static ::llvm::cl::OptionCategory DebugCategory("Debug Options");
 Options::Options(int argc, char** argv)
     : _filepath(),
       _argv(),
+      _instrumentation(Instrumentation::Block),
+      _input(),
+      _iterations(0),
+      _budget(0),
+      _trace_file(),
+      _shadow(false),
+      _frames(false),
+      _seed(0),
+      _jobs(1),
+      _priority(Priority::Coverage),
+      _batch(),
+      _batch_io_jobs(2),
+      _batch_parse_jobs(1),
+      _batch_static_jobs(1),
+      _batch_jobs(0),
+      _batch_depth(16),
+      _results(),
+      _cache(),
       _status(false) {
   ::llvm::cl::ParseCommandLineOptions(argc,
                                       argv,
                                       "banal -- buffer overflow analysis");
 
   _filepath = InputFilename.getValue();
+  _batch = BatchList.getValue();
+  if (_filepath.empty() == _batch.empty()) {
+    log::cerr() << "Give either a binary file or -batch." << ::std::endl;
+    return;
+  }
   _status = true;
   _argv = Argv;
+  _instrumentation = InstrumentationMode.getValue();
+  _input = InputFile.getValue();
+  _iterations = Iterations.getValue();
+  _budget = Budget.getValue();
+  _trace_file = TraceFile.getValue();
+  _shadow = ShadowStack.getValue();
+  _frames = FrameBounds.getValue();
+  _seed = Seed.getValue();
+  _jobs = Jobs.getValue();
+  _priority = JobPriority.getValue();
+  _batch_io_jobs = BatchIOJobs.getValue();
+  _batch_parse_jobs = BatchParseJobs.getValue();
+  _batch_static_jobs = BatchStaticJobs.getValue();
+  _batch_jobs = BatchJobs.getValue();
+  _batch_depth = BatchDepth.getValue();
+  _results = BatchResults.getValue();
+  _cache = CacheFile.getValue();
 }
 
 } // end namespace banal
@@ -0,0 +1,153 @@
+///
+/// \file
+/// \brief Work-stealing scheduler implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <algorithm>
+#include <thread>
+
+#include "banal/scheduler.hpp"
+
+namespace banal {
+
+namespace {
+
+/// \brief Number of times an idle worker yields before sleeping
+constexpr ::std::size_t Spins = 64;
+
+} // end anonymous namespace
+
+Scheduler::Scheduler(::std::size_t workers,
+                     Priority priority,
+                     ::std::size_t limit)
+    : _pools(),
+      _priority(priority),
+      _limit(limit),
+      _created(0),
+      _pending(0),
+      _mutex(),
+      _idle(),
+      _events(0) {
+  for (::std::size_t i = 0; i < workers; i++) {
+    _pools.push_back(::std::make_unique< Pool >());
+  }
+}
+
+bool Scheduler::lower(const Job& a, const Job& b) const {
+  switch (_priority) {
+    case Priority::Depth: {
+      if (a.depth != b.depth) {
+        return a.depth < b.depth;
+      }
+    } break;
+    case Priority::Coverage: {
+      if (a.coverage != b.coverage) {
+        return a.coverage < b.coverage;
+      }
+    } break;
+    case Priority::Danger: {
+      if (a.danger != b.danger) {
+        return a.danger < b.danger;
+      }
+    } break;
+  }
+  // oldest first
+  return a.iteration > b.iteration;
+}
+
+::std::optional<::std::size_t > Scheduler::reserve(void) {
+  auto iteration = _created.fetch_add(1, ::std::memory_order_relaxed);
+  if (iteration >= _limit) {
+    return ::std::nullopt;
+  }
+  return iteration;
+}
+
+void Scheduler::push(::std::size_t worker, Job job) {
+  auto& pool = *_pools[worker];
+  _pending.fetch_add(1, ::std::memory_order_acq_rel);
+  {
+    ::std::lock_guard< ::std::mutex > lock(pool.mutex);
+    pool.jobs.push_back(::std::move(job));
+    ::std::push_heap(pool.jobs.begin(),
+                     pool.jobs.end(),
+                     [this](const Job& a, const Job& b) {
+                       return this->lower(a, b);
+                     });
+  }
+  this->notify();
+}
+
+void Scheduler::notify(void) {
+  {
+    ::std::lock_guard< ::std::mutex > lock(_mutex);
+    _events++;
+  }
+  _idle.notify_all();
+}
+
+bool Scheduler::take(Pool& pool, Job& job) {
+  ::std::lock_guard< ::std::mutex > lock(pool.mutex);
+  if (pool.jobs.empty()) {
+    return false;
+  }
+  ::std::pop_heap(pool.jobs.begin(),
+                  pool.jobs.end(),
+                  [this](const Job& a, const Job& b) {
+                    return this->lower(a, b);
+                  });
+  job = ::std::move(pool.jobs.back());
+  pool.jobs.pop_back();
+  return true;
+}
+
+bool Scheduler::pop(::std::size_t worker, Job& job) {
+  auto count = _pools.size();
+  for (::std::size_t spins = 0;; spins++) {
+    ::std::size_t events = 0;
+    if (spins >= Spins) {
+      ::std::lock_guard< ::std::mutex > lock(_mutex);
+      events = _events;
+    }
+    if (this->take(*_pools[worker], job)) {
+      return true;
+    }
+    // steal, starting from the next worker
+    for (::std::size_t i = 1; i < count; i++) {
+      if (this->take(*_pools[(worker + i) % count], job)) {
+        return true;
+      }
+    }
+    if (_pending.load(::std::memory_order_acquire) == 0) {
+      // nothing pending, nothing running: nobody can push anymore
+      return false;
+    }
+    if (spins < Spins) {
+      ::std::this_thread::yield();
+      continue;
+    }
+    // sleep until something is pushed or done after the pools were read
+    ::std::unique_lock< ::std::mutex > lock(_mutex);
+    _idle.wait(lock, [this, events] { return _events != events; });
+  }
+}
+
+void Scheduler::done(void) {
+  _pending.fetch_sub(1, ::std::memory_order_acq_rel);
+  this->notify();
+}
+
+void Scheduler::cancel(void) {
+  _created.store(_limit, ::std::memory_order_relaxed);
+  for (auto& pool : _pools) {
+    ::std::lock_guard< ::std::mutex > lock(pool->mutex);
+    _pending.fetch_sub(pool->jobs.size(), ::std::memory_order_acq_rel);
+    pool->jobs.clear();
+  }
+  this->notify();
+}
+
+} // end namespace banal
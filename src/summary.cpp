@@ -0,0 +1,320 @@
+///
+/// \file
+/// \brief Function summaries implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+#include <elfio/elf_types.hpp>
+
+#include "banal/architecture.hpp"
+#include "banal/summary.hpp"
+#include "banal/util/hash.hpp"
+#include "banal/util/log.hpp"
+
+namespace banal {
+
+namespace {
+
+/// \brief Functions which write memory without bounds
+constexpr ::std::string_view Dangerous[] = {"gets",
+                                            "strcpy",
+                                            "strcat",
+                                            "sprintf",
+                                            "vsprintf",
+                                            "scanf",
+                                            "sscanf",
+                                            "fscanf",
+                                            "memcpy",
+                                            "memmove",
+                                            "read"};
+
+/// \brief Words hashed per instruction: id, operand count, and 4 per
+/// operand
+constexpr ::std::size_t InsnWords = 2 + 8 * 4;
+
+} // end anonymous namespace
+
+bool dangerous(::std::string_view name) {
+  return ::std::find(::std::begin(Dangerous), ::std::end(Dangerous), name) !=
+         ::std::end(Dangerous);
+}
+
+Summarizer::Summarizer(const binary::Binary& binary)
+    : _binary(binary),
+      _csh(0),
+      _insn(nullptr),
+      _low(UINT64_MAX),
+      _high(0),
+      _sp(0),
+      _bp(0),
+      _word(0),
+      _good(false) {
+  auto architecture = binary.architecture();
+  if (architecture != Architecture::X86 &&
+      architecture != Architecture::X86_64) {
+    return;
+  }
+  auto capstone_value = get_cs_architecture(architecture);
+  if (auto e = ::cs_open(capstone_value.first, capstone_value.second, &_csh);
+      e != ::CS_ERR_OK) {
+    log::cerr() << "Unable to initialize Capstone engine: " << ::cs_strerror(e)
+                << ::std::endl;
+    _csh = 0;
+    return;
+  }
+  ::cs_option(_csh, ::CS_OPT_DETAIL, ::CS_OPT_ON);
+  if (_insn = ::cs_malloc(_csh); !_insn) {
+    return;
+  }
+  _sp = get_sp(architecture).first;
+  if (architecture == Architecture::X86_64) {
+    _bp = ::X86_REG_RBP;
+    _word = 8;
+  } else {
+    _bp = ::X86_REG_EBP;
+    _word = 4;
+  }
+  for (auto it = binary.segments_cbegin(); it != binary.segments_cend(); it++) {
+    const auto& seg = *it;
+    if (seg->type() == PT_LOAD) {
+      _low = ::std::min<::std::uint64_t >(_low, seg->virtual_address());
+      _high = ::std::max<::std::uint64_t >(
+          _high, seg->virtual_address() + seg->memory_size());
+    }
+  }
+  _good = true;
+}
+
+Summarizer::~Summarizer(void) {
+  if (_insn) {
+    ::cs_free(_insn, 1);
+  }
+  if (_csh) {
+    ::cs_close(&_csh);
+  }
+}
+
+::std::optional<::std::string_view > Summarizer::code(
+    const binary::component::Symbol& function) const {
+  auto offset = _binary.get_address(function);
+  if (!offset || *offset >= _binary.size() ||
+      function.size() > _binary.size() - *offset) {
+    return ::std::nullopt;
+  }
+  return ::std::string_view(
+      reinterpret_cast< const char* >(_binary.begin() + *offset),
+      function.size());
+}
+
+::std::string_view Summarizer::callee(void) const {
+  const auto& x86 = _insn->detail->x86;
+  if (x86.op_count != 1 || x86.operands[0].type != ::X86_OP_IMM) {
+    return {};
+  }
+  auto target = static_cast< uintarch_t >(x86.operands[0].imm);
+  if (auto symbol = _binary.get_symbol(target);
+      symbol && symbol->value() == target) {
+    return symbol->name();
+  }
+  return {};
+}
+
+::std::optional<::std::uint64_t > Summarizer::hash(
+    const binary::component::Symbol& function) {
+  auto code = this->code(function);
+  if (!code) {
+    return ::std::nullopt;
+  }
+  const auto* data = reinterpret_cast< const ::std::uint8_t* >(code->data());
+  auto left = code->size();
+  ::std::uint64_t address = function.value();
+  ::std::uint64_t h = 0;
+  ::std::uint64_t words[InsnWords];
+  while (left > 0 && ::cs_disasm_iter(_csh, &data, &left, &address, _insn)) {
+    const auto& x86 = _insn->detail->x86;
+    bool branch = ::cs_insn_group(_csh, _insn, ::CS_GRP_JUMP) ||
+                  ::cs_insn_group(_csh, _insn, ::CS_GRP_CALL);
+    ::std::size_t n = 0;
+    words[n++] = _insn->id;
+    words[n++] = x86.op_count;
+    for (::std::uint8_t i = 0; i < x86.op_count && i < 8; i++) {
+      const auto& op = x86.operands[i];
+      words[n++] = op.type;
+      switch (op.type) {
+        case ::X86_OP_REG: {
+          words[n++] = op.reg;
+          words[n++] = 0;
+          words[n++] = 0;
+        } break;
+        case ::X86_OP_IMM: {
+          // calls are hashed by the name of their target, other addresses
+          // depend on the layout
+          auto imm = static_cast<::std::uint64_t >(op.imm);
+          if (auto name = branch ? this->callee() : ::std::string_view();
+              !name.empty()) {
+            imm = util::murmur64(name.data(), name.size());
+          } else if (branch || (imm >= _low && imm < _high)) {
+            imm = 0;
+          }
+          words[n++] = imm;
+          words[n++] = 0;
+          words[n++] = 0;
+        } break;
+        case ::X86_OP_MEM: {
+          auto disp = static_cast<::std::uint64_t >(op.mem.disp);
+          bool relative =
+              op.mem.base == ::X86_REG_RIP || op.mem.base == ::X86_REG_EIP;
+          bool absolute = op.mem.base == ::X86_REG_INVALID &&
+                          disp >= _low && disp < _high;
+          words[n++] = (static_cast<::std::uint64_t >(op.mem.segment) << 32) |
+                       static_cast<::std::uint64_t >(op.mem.base);
+          words[n++] = (static_cast<::std::uint64_t >(op.mem.index) << 32) |
+                       static_cast<::std::uint32_t >(op.mem.scale);
+          words[n++] = relative || absolute ? 0 : disp;
+        } break;
+        default: {
+          words[n++] = 0;
+          words[n++] = 0;
+          words[n++] = 0;
+        }
+      }
+    }
+    h = util::murmur64(words, n * sizeof(words[0]), h);
+  }
+  // an undecodable tail is hashed as is
+  h = util::murmur64(data, left, h);
+  return h ? h : 1;
+}
+
+::std::optional< Summary > Summarizer::summarize(
+    const binary::component::Symbol& function) {
+  auto code = this->code(function);
+  if (!code) {
+    return ::std::nullopt;
+  }
+  const auto* data = reinterpret_cast< const ::std::uint8_t* >(code->data());
+  auto left = code->size();
+  ::std::uint64_t address = function.value();
+
+  // depths are counted in bytes below the stack pointer at entry, where the
+  // return address is
+  ::std::int64_t depth = 0;
+  ::std::int64_t frame = 0;
+  // depth once the prologue is over, that of the code following a ret or a
+  // jmp, only reached by a branch from the body
+  ::std::optional<::std::int64_t > body;
+  ::std::optional<::std::int64_t > bp_depth;
+  ::std::int64_t low = ::std::numeric_limits<::std::int64_t >::max();
+  ::std::int64_t high = ::std::numeric_limits<::std::int64_t >::min();
+  ::std::uint8_t verdict = Verdict::None;
+  while (left > 0 && ::cs_disasm_iter(_csh, &data, &left, &address, _insn)) {
+    const auto& x86 = _insn->detail->x86;
+    const auto& dst = x86.operands[0];
+    const auto& src = x86.operands[1];
+    auto before = depth;
+    bool prologue = false;
+    switch (_insn->id) {
+      case ::X86_INS_ENDBR32:
+      case ::X86_INS_ENDBR64: {
+        prologue = true;
+      } break;
+      case ::X86_INS_PUSH: {
+        depth += _word;
+        prologue = true;
+      } break;
+      case ::X86_INS_POP: {
+        depth -= _word;
+      } break;
+      case ::X86_INS_SUB:
+      case ::X86_INS_ADD: {
+        if (x86.op_count == 2 && dst.type == ::X86_OP_REG && dst.reg == _sp &&
+            src.type == ::X86_OP_IMM) {
+          depth += _insn->id == ::X86_INS_SUB ? src.imm : -src.imm;
+          prologue = _insn->id == ::X86_INS_SUB;
+        }
+      } break;
+      case ::X86_INS_ENTER: {
+        depth += _word + (x86.op_count > 0 ? dst.imm : 0);
+        bp_depth = depth - static_cast<::std::int64_t >(
+                               x86.op_count > 0 ? dst.imm : 0);
+        prologue = true;
+      } break;
+      case ::X86_INS_LEAVE: {
+        // mov sp, bp then pop bp
+        if (bp_depth) {
+          depth = *bp_depth - _word;
+        }
+      } break;
+      case ::X86_INS_MOV: {
+        if (x86.op_count == 2 && dst.type == ::X86_OP_REG && dst.reg == _bp &&
+            src.type == ::X86_OP_REG && src.reg == _sp) {
+          bp_depth = depth;
+          prologue = true;
+        }
+      } break;
+      case ::X86_INS_CALL: {
+        if (dangerous(this->callee())) {
+          verdict |= Verdict::Dangerous;
+        }
+      } break;
+    }
+    if (!prologue && !body) {
+      body = before;
+    }
+    frame = ::std::max(frame, depth);
+
+    for (::std::uint8_t i = 0; i < x86.op_count; i++) {
+      const auto& op = x86.operands[i];
+      if (op.type != ::X86_OP_MEM || !(op.access & ::CS_AC_WRITE)) {
+        continue;
+      }
+      ::std::int64_t base;
+      if (op.mem.base == _sp) {
+        base = depth;
+      } else if (op.mem.base == _bp && bp_depth) {
+        base = *bp_depth;
+      } else {
+        continue;
+      }
+      if (op.mem.index != ::X86_REG_INVALID) {
+        verdict |= Verdict::Indexed;
+        continue;
+      }
+      low = ::std::min(low, op.mem.disp - base);
+      high = ::std::max(high, op.mem.disp - base + op.size);
+    }
+
+    if (_insn->id == ::X86_INS_RET || _insn->id == ::X86_INS_JMP) {
+      depth = body.value_or(0);
+    }
+  }
+  if (left > 0) {
+    verdict |= Verdict::Partial;
+  }
+  if (low > high) {
+    low = high = 0;
+  } else if (high > 0) {
+    verdict |= Verdict::Escapes;
+  }
+
+  auto clamp = [](::std::int64_t v) {
+    return static_cast<::std::int32_t >(
+        ::std::clamp< ::std::int64_t >(v, INT32_MIN, INT32_MAX));
+  };
+  // value initialized, padding included, since summaries are cached as raw
+  // bytes
+  auto summary = Summary();
+  summary.frame = static_cast<::std::uint32_t >(clamp(frame));
+  summary.low = clamp(low);
+  summary.high = clamp(high);
+  summary.verdict = verdict;
+  return summary;
+}
+
+} // end namespace banal
@@ -0,0 +1,124 @@
+///
+/// \file
+/// \brief Trace reader implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <sys/fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "banal/trace/reader.hpp"
+#include "banal/util/log.hpp"
+
+namespace banal {
+namespace trace {
+
+Reader::Reader(const ::std::string& path)
+    : _begin(nullptr),
+      _end(nullptr),
+      _cursor(nullptr),
+      _header(),
+      _blocks(),
+      _last(0),
+      _good(false) {
+  auto fd = ::open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    log::cerr() << "Unable to open " << path << ": " << ::std::strerror(errno)
+                << ::std::endl;
+    return;
+  }
+  struct stat file_stat;
+  if (::fstat(fd, &file_stat) != 0 ||
+      static_cast<::std::size_t >(file_stat.st_size) < sizeof(Header)) {
+    log::cerr() << path << " is not a trace file." << ::std::endl;
+    ::close(fd);
+    return;
+  }
+  auto size = static_cast<::std::size_t >(file_stat.st_size);
+  void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    log::cerr() << "Unable to map file " << path << ": "
+                << ::std::strerror(errno) << ::std::endl;
+    return;
+  }
+  ::madvise(addr, size, MADV_SEQUENTIAL);
+  _begin = static_cast< const ::std::uint8_t* >(addr);
+  _end = _begin + size;
+  _cursor = _begin + sizeof(Header);
+
+  ::std::memcpy(&_header, _begin, sizeof(_header));
+  if (::std::memcmp(_header.magic, Magic, sizeof(Magic)) != 0 ||
+      _header.version != Version) {
+    log::cerr() << path << " is not a trace file (version " << ::std::dec
+                << Version << ")." << ::std::endl;
+    return;
+  }
+  _good = true;
+}
+
+Reader::~Reader(void) {
+  if (_begin) {
+    ::munmap(const_cast<::std::uint8_t* >(_begin),
+             static_cast<::std::size_t >(_end - _begin));
+  }
+}
+
+bool Reader::next(Event& event) {
+  if (!_good) {
+    return false;
+  }
+  for (;;) {
+    if (_cursor == _end) {
+      // end of the trace
+      return false;
+    }
+    ::std::uint64_t v;
+    ::std::uint64_t a;
+    ::std::uint64_t b;
+    if (!get_varint(_cursor, _end, v)) {
+      break;
+    }
+    if (!(v & 1)) {
+      event.kind = Event::Kind::Block;
+      event.id = v >> 1;
+      if (event.id >= _blocks.size()) {
+        log::cerr() << "Undefined block " << ::std::dec << event.id
+                    << " in trace." << ::std::endl;
+        return _good = false;
+      }
+      return true;
+    }
+    if (!get_varint(_cursor, _end, a) || !get_varint(_cursor, _end, b)) {
+      break;
+    }
+    if (static_cast< Entry >(v >> 1) == Entry::End) {
+      event.kind = Event::Kind::End;
+      event.reason = a;
+      event.pc = b;
+      return true;
+    }
+    if (static_cast< Entry >(v >> 1) != Entry::Define) {
+      log::cerr() << "Unknown entry in trace." << ::std::endl;
+      return _good = false;
+    }
+    if (static_cast<::std::size_t >(_end - _cursor) < b) {
+      break;
+    }
+    _last += static_cast<::std::uint64_t >(unzigzag(a));
+    _blocks.push_back(BlockInfo{_last, b, _cursor});
+    _cursor += b;
+  }
+  log::cerr() << "Truncated trace." << ::std::endl;
+  return _good = false;
+}
+
+} // end namespace trace
+} // end namespace banal
@@ -0,0 +1,98 @@
+///
+/// \file
+/// \brief Trace writer implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <cstring>
+
+#include "banal/trace/writer.hpp"
+#include "banal/util/hash.hpp"
+#include "banal/util/log.hpp"
+
+namespace banal {
+namespace trace {
+
+namespace {
+
+/// \brief Size of the pending output which triggers a write
+constexpr ::std::size_t FlushSize = 1 << 16;
+
+} // end anonymous namespace
+
+Writer::Writer(const ::std::string& path, const binary::Binary& binary)
+    : _out(path, ::std::ios::binary | ::std::ios::trunc),
+      _buffer(),
+      _ids(),
+      _bytes(),
+      _last(0),
+      _good(false) {
+  if (!_out) {
+    log::cerr() << "Unable to open trace file " << path << ::std::endl;
+    return;
+  }
+  Header header;
+  ::std::memcpy(header.magic, Magic, sizeof(header.magic));
+  header.version = Version;
+  header.architecture = static_cast<::std::uint32_t >(binary.architecture());
+  header.hash = util::murmur64(binary.begin(), binary.size());
+  header.size = binary.size();
+  _out.write(reinterpret_cast< const char* >(&header), sizeof(header));
+  _buffer.reserve(FlushSize + 4096);
+  _good = static_cast< bool >(_out);
+}
+
+Writer::~Writer(void) {
+  this->flush();
+}
+
+void Writer::flush(void) {
+  if (_good && !_buffer.empty()) {
+    _out.write(reinterpret_cast< const char* >(_buffer.data()),
+               static_cast<::std::streamsize >(_buffer.size()));
+  }
+  _buffer.clear();
+}
+
+void Writer::on_block(execution::Engine& engine,
+                      const execution::Block& block) {
+  if (!_good) {
+    return;
+  }
+  auto [it, inserted] = _ids.try_emplace(block.address, _ids.size());
+  if (inserted) {
+    _bytes.resize(block.size);
+    if (const auto* host = engine.memory(block.address, block.size); host) {
+      ::std::memcpy(_bytes.data(), host, _bytes.size());
+    } else if (auto e = ::uc_mem_read(
+                   engine.uc(), block.address, _bytes.data(), _bytes.size());
+               e != ::UC_ERR_OK) {
+      ::std::memset(_bytes.data(), 0, _bytes.size());
+    }
+    this->put((static_cast<::std::uint64_t >(Entry::Define) << 1) | 1);
+    this->put(zigzag(static_cast<::std::int64_t >(block.address - _last)));
+    this->put(block.size);
+    _buffer.insert(_buffer.end(), _bytes.begin(), _bytes.end());
+    _last = block.address;
+  }
+  this->put(it->second << 1);
+  if (_buffer.size() >= FlushSize) {
+    this->flush();
+  }
+}
+
+void Writer::end(const execution::Outcome& outcome) {
+  if (!_good) {
+    return;
+  }
+  this->put((static_cast<::std::uint64_t >(Entry::End) << 1) | 1);
+  this->put(static_cast<::std::uint64_t >(outcome.reason));
+  this->put(outcome.pc);
+  this->flush();
+  _out.flush();
+}
+
+} // end namespace trace
+} // end namespace banal
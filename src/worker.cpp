@@ -0,0 +1,139 @@
+///
+/// \file
+/// \brief Exploration worker implementation
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <algorithm>
+
+#include "banal/summary.hpp"
+#include "banal/worker.hpp"
+
+namespace banal {
+
+namespace {
+
+/// \brief Number of children of a run which has found something
+constexpr ::std::size_t Children = 8;
+
+} // end anonymous namespace
+
+Worker::Worker(const Options& opt,
+               binary::Binary& binary,
+               ::std::size_t index,
+               Coverage& coverage)
+    : _options(opt),
+      _binary(binary),
+      _index(index),
+      _coverage(coverage),
+      _mutator(opt.seed() ^ (index * 0x9e3779b97f4a7c15ULL)),
+      _handles(binary.architecture()),
+      _engine(),
+      _main(),
+      _findings(),
+      _runs(0),
+      _new_blocks(0),
+      _danger(0),
+      _good(false) {
+  if (!_handles.good()) {
+    return;
+  }
+  _engine = ::std::make_unique< execution::Engine >(
+      _handles.uc(), _handles.csh(), binary, opt.instrumentation());
+  if (!_engine->good()) {
+    log::cerr() << "Unable to prepare the execution engine." << ::std::endl;
+    return;
+  }
+  if (!_engine->watch(execution::checks(opt))) {
+    log::cerr() << "Unable to watch the stack." << ::std::endl;
+    return;
+  }
+  _engine->attach(*this);
+  if (_main = _engine->snapshot(); !_main) {
+    log::cerr() << "Unable to take a snapshot at main." << ::std::endl;
+    return;
+  }
+  _good = true;
+}
+
+Worker::~Worker(void) {
+  // the engine uses the handlers
+  _main.reset();
+  _engine.reset();
+}
+
+void Worker::on_block(execution::Engine&, const execution::Block& block) {
+  if (_coverage.add(block.address)) {
+    _new_blocks++;
+  }
+}
+
+void Worker::on_call(execution::Engine&,
+                     uintarch_t,
+                     uintarch_t target,
+                     uintarch_t) {
+  if (auto symbol = _binary.get_symbol(target); symbol) {
+    auto name = symbol->name();
+    if (dangerous(name)) {
+      _danger++;
+    }
+  }
+}
+
+bool Worker::execute(Scheduler& scheduler, const Job& job) {
+  if (!_engine->restore(*_main) || !_engine->prepare(job.input)) {
+    return false;
+  }
+  _runs++;
+  _new_blocks = 0;
+  _danger = 0;
+  if (!_engine->emulate(_options.budget())) {
+    const auto& outcome = _engine->outcome();
+    if (::std::none_of(
+            _findings.begin(), _findings.end(), [&outcome](const auto& f) {
+              return f.reason == outcome.reason && f.pc == outcome.pc &&
+                     f.error == outcome.error;
+            })) {
+      _findings.push_back(Finding{job.iteration,
+                                  outcome.reason,
+                                  outcome.pc,
+                                  outcome.error,
+                                  outcome.frame,
+                                  outcome.caller,
+                                  outcome.code,
+                                  job.input});
+    }
+  }
+
+  // children go to the pool of the worker, idle workers steal them
+  auto count = (_new_blocks > 0 || _danger > 0) ? Children : 1;
+  for (::std::size_t i = 0; i < count; i++) {
+    auto iteration = scheduler.reserve();
+    if (!iteration) {
+      break;
+    }
+    Job child{*iteration, job.depth + 1, _new_blocks, _danger, job.input};
+    _mutator.mutate(child.input);
+    scheduler.push(_index, ::std::move(child));
+  }
+  return true;
+}
+
+void Worker::run(Scheduler& scheduler) {
+  Job job{0, 0, 0, 0, {}};
+  while (scheduler.pop(_index, job)) {
+    auto ok = this->execute(scheduler, job);
+    scheduler.done();
+    if (!ok) {
+      log::cerr() << "Worker stopped at iteration " << ::std::dec
+                  << job.iteration << ::std::endl;
+      // the pool cannot finish the exploration without this worker
+      scheduler.cancel();
+      return;
+    }
+  }
+}
+
+} // end namespace banal
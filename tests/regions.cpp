@@ -0,0 +1,205 @@
+///
+/// \file
+/// \brief Tests of the memory regions: split, protect, unmap and merge
+///
+/// Author: Thomas Bailleux
+///
+/// Contact: thomas at bailleux.me
+
+#include <sys/mman.h>
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <unicorn/unicorn.h>
+
+#include "banal/execution/map.hpp"
+#include "banal/execution/regions.hpp"
+
+namespace {
+
+using ::banal::execution::ChunkSize;
+using ::banal::execution::InsnCache;
+using ::banal::execution::Map;
+using ::banal::execution::PageSize;
+using ::banal::execution::Regions;
+
+/// \brief Address of the first map
+constexpr ::std::uint64_t Base = 0x100000;
+
+/// \brief Read and write permissions
+constexpr ::std::uint32_t RW = ::UC_PROT_READ | ::UC_PROT_WRITE;
+
+/// \brief Number of failed checks
+int failures = 0;
+
+/// \brief Check a condition
+///
+/// \param ok The condition
+/// \param what What is checked
+void check(bool ok, const char* what) {
+  if (!ok) {
+    ::std::cerr << "FAIL: " << what << ::std::endl;
+    failures++;
+  }
+}
+
+/// \brief Reserve host memory
+///
+/// \param size Size of the memory
+///
+/// \return The memory
+::std::uint8_t* reserve(::std::size_t size) {
+  void* addr = ::mmap(nullptr,
+                      size,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                      -1,
+                      0);
+  return addr == MAP_FAILED ? nullptr : static_cast<::std::uint8_t* >(addr);
+}
+
+/// \brief Tell if every unicorn region belongs to a single map
+///
+/// \param uc Unicorn engine
+/// \param maps Memory maps
+///
+/// \return true if it does, else false
+bool regions_in_maps(::uc_engine* uc, const Regions& maps) {
+  ::uc_mem_region* regions = nullptr;
+  ::std::uint32_t count = 0;
+  if (::uc_mem_regions(uc, &regions, &count) != ::UC_ERR_OK) {
+    return false;
+  }
+  bool ok = true;
+  for (::std::uint32_t i = 0; i < count; i++) {
+    const Map* m = maps.find(regions[i].begin);
+    ok = ok && m && regions[i].end < m->address() + m->size() &&
+         regions[i].perms == m->perms();
+  }
+  ::uc_free(regions);
+  return ok;
+}
+
+/// \brief Tell if a range can be read
+///
+/// \param uc Unicorn engine
+/// \param address Address of the range
+/// \param size Size of the range
+///
+/// \return true if it can, else false
+bool readable(::uc_engine* uc, ::std::uint64_t address, ::std::size_t size) {
+  ::std::vector<::std::uint8_t > data(size);
+  return ::uc_mem_read(uc, address, data.data(), size) == ::UC_ERR_OK;
+}
+
+/// \brief Protect and unmap parts of host memory
+///
+/// \param uc Unicorn engine
+/// \param cache Instruction cache
+void test_host(::uc_engine* uc, InsnCache& cache) {
+  Regions maps;
+  const ::std::size_t size = 4 * ChunkSize;
+  Map* m = maps.add(
+      ::std::make_unique< Map >(uc, Base, size, RW, reserve(size), &cache));
+  check(m && m->fault(Base, size), "host map is registered");
+  ::std::vector<::std::uint8_t > data(size);
+  for (::std::size_t i = 0; i < size; i++) {
+    data[i] = static_cast<::std::uint8_t >(i * 7);
+  }
+  check(::uc_mem_write(uc, Base, data.data(), size) == ::UC_ERR_OK,
+        "host map is written");
+
+  // a page inside of a chunk, so that the chunk is split
+  auto page = Base + ChunkSize + PageSize;
+  check(maps.protect(page, PageSize, ::UC_PROT_READ), "protect a page");
+  check(maps.size() == 3, "protect splits the map in three");
+  check(regions_in_maps(uc, maps), "protect splits the unicorn regions");
+  check(maps.find(page)->perms() == ::UC_PROT_READ &&
+            maps.find(page - 1)->perms() == RW &&
+            maps.find(page + PageSize)->perms() == RW,
+        "only the page is read only");
+  ::std::vector<::std::uint8_t > read(size);
+  check(::uc_mem_read(uc, Base, read.data(), size) == ::UC_ERR_OK &&
+            read == data,
+        "protect keeps the content");
+
+  check(maps.protect(page, PageSize, RW), "protect the page back");
+  check(maps.size() == 1, "maps are merged back");
+  check(regions_in_maps(uc, maps), "merged map holds the unicorn regions");
+
+  check(maps.unmap(page, PageSize), "unmap a page");
+  check(maps.size() == 2, "unmap splits the map in two");
+  check(!maps.find(page), "unmapped page has no map");
+  check(!readable(uc, page, PageSize), "unmapped page cannot be read");
+  check(readable(uc, Base, page - Base) &&
+            readable(uc, page + PageSize, Base + size - page - PageSize),
+        "neighbours stay readable");
+  check(regions_in_maps(uc, maps), "unmap splits the unicorn regions");
+  check(!maps.protect(Base, size, ::UC_PROT_READ),
+        "cannot protect an unmapped range");
+  check(!maps.unmap(Base + 1, PageSize), "cannot unmap an unaligned range");
+}
+
+/// \brief Protect parts of memory owned by unicorn
+///
+/// \param uc Unicorn engine
+/// \param cache Instruction cache
+void test_unicorn(::uc_engine* uc, InsnCache& cache) {
+  Regions maps;
+  const ::std::size_t size = 4 * PageSize;
+  check(maps.add(::std::make_unique< Map >(uc, Base, size, RW, &cache)),
+        "unicorn map is mapped");
+  check(maps.protect(Base + PageSize, 2 * PageSize, ::UC_PROT_READ),
+        "protect two pages");
+  check(maps.size() == 3, "protect splits the map in three");
+  check(regions_in_maps(uc, maps), "protect splits the unicorn region");
+  check(maps.unmap(Base, PageSize), "unmap the first page");
+  check(!readable(uc, Base, PageSize), "unmapped page cannot be read");
+  check(readable(uc, Base + PageSize, size - PageSize),
+        "the rest stays readable");
+}
+
+/// \brief Merge neighbour maps when their host memory is contiguous
+///
+/// \param uc Unicorn engine
+/// \param cache Instruction cache
+void test_merge(::uc_engine* uc, InsnCache& cache) {
+  Regions maps;
+  auto* host = reserve(4 * PageSize);
+  check(maps.add(::std::make_unique< Map >(
+            uc, Base, 2 * PageSize, RW, host, &cache)) &&
+            maps.add(::std::make_unique< Map >(uc,
+                                               Base + 2 * PageSize,
+                                               2 * PageSize,
+                                               RW,
+                                               host + 2 * PageSize,
+                                               &cache)),
+        "contiguous maps are added");
+  check(maps.size() == 1, "contiguous maps are merged");
+  check(maps.add(::std::make_unique< Map >(
+            uc, Base + 4 * PageSize, PageSize, RW, reserve(PageSize), &cache)),
+        "separate map is added");
+  check(maps.size() == 2, "separate host memory is not merged");
+}
+
+} // end anonymous namespace
+
+int main(void) {
+  ::uc_engine* uc = nullptr;
+  if (::uc_open(::UC_ARCH_X86, ::UC_MODE_64, &uc) != ::UC_ERR_OK) {
+    ::std::cerr << "Unable to open unicorn." << ::std::endl;
+    return 1;
+  }
+  InsnCache cache;
+  test_host(uc, cache);
+  test_unicorn(uc, cache);
+  test_merge(uc, cache);
+  ::uc_close(uc);
+  if (failures) {
+    ::std::cerr << failures << " check(s) failed." << ::std::endl;
+  }
+  return failures ? 1 : 0;
+}